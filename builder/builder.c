@@ -13,35 +13,246 @@
 
 #include "../saugns.h"
 #include "../script.h"
+#include "../trace.h"
+#include "../reader/file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_EXT ".sauprg"
+#define CACHE_TMP_EXT ".sauprg.tmp"
 
 /*
- * Create program for the given script file. Invokes the parser.
+ * Add \p len bytes of script contents to \p key: counting them,
+ * and hashing them using 64-bit FNV-1a and, for checking, sdbm.
+ */
+static void add_to_key(SAU_ProgramSrcKey *restrict key,
+		const uint8_t *restrict c, size_t len) {
+	uint64_t hash = key->hash, check = key->check;
+	for (size_t i = 0; i < len; ++i) {
+		hash = (hash ^ c[i]) * 1099511628211U;
+		check = c[i] + (check << 6) + (check << 16) - check;
+	}
+	key->hash = hash;
+	key->check = check;
+	key->len += len;
+}
+
+/*
+ * Get key for the contents of the given script file, or string
+ * if \p is_path is false, for naming and checking cache files.
+ * The file is opened as for parsing, hashed in place if mapped.
+ *
+ * \return true, or false if the file couldn't be read
+ */
+static bool get_script_key(SAU_ProgramSrcKey *restrict key,
+		const char *restrict script_arg, bool is_path) {
+	*key = (SAU_ProgramSrcKey){0, 14695981039346656037U, 0};
+	if (!is_path) {
+		add_to_key(key, (const uint8_t*) script_arg,
+				strlen(script_arg));
+		return true;
+	}
+	SAU_File *f = SAU_create_File();
+	if (!f)
+		return false;
+	bool ok = SAU_File_fopenrb(f, script_arg);
+	if (ok) {
+		const uint8_t *span;
+		size_t len;
+		while ((len = SAU_File_getspan(f, &span)) > 0)
+			add_to_key(key, span, len);
+		ok = !(SAU_File_STATUS(f) & SAU_FILE_ERROR);
+	}
+	SAU_destroy_File(f);
+	return ok;
+}
+
+/*
+ * Get path for program cache file in \p cache_dir, named using
+ * the hash in \p key.
+ *
+ * \return allocated string, or NULL on error
+ */
+static char *get_cache_path(const char *restrict cache_dir,
+		const SAU_ProgramSrcKey *restrict key) {
+	size_t len = strlen(cache_dir) + 1 + 16 + sizeof(CACHE_TMP_EXT);
+	char *path = malloc(len);
+	if (!path)
+		return NULL;
+	snprintf(path, len, "%s/%08lx%08lx" CACHE_EXT, cache_dir,
+			(unsigned long) (key->hash >> 32),
+			(unsigned long) (key->hash & 0xffffffff));
+	return path;
+}
+
+/*
+ * Write program to cache file at \p path, replacing any old file
+ * once successfully written.
+ */
+static void write_cache(const SAU_Program *restrict prg,
+		const SAU_ProgramSrcKey *restrict key, char *restrict path) {
+	size_t len = strlen(path);
+	char *tmp_path = malloc(len + sizeof(".tmp"));
+	bool ok = false;
+	if (tmp_path != NULL) {
+		memcpy(tmp_path, path, len);
+		memcpy(&tmp_path[len], ".tmp", sizeof(".tmp"));
+		FILE *f = fopen(tmp_path, "wb");
+		if (f != NULL) {
+			ok = SAU_Program_write(prg, key, f);
+			if (fclose(f) != 0) ok = false;
+			if (ok) ok = (rename(tmp_path, path) == 0);
+			if (!ok) remove(tmp_path);
+		}
+		free(tmp_path);
+	}
+	if (!ok)
+		SAU_warning(NULL, "couldn't write program cache file \"%s\"",
+				path);
+}
+
+/*
+ * Print again the messages printed when building program \p prg,
+ * each kept without the file path.
+ */
+static void print_build_msgs(const SAU_Program *restrict prg) {
+	const char *msg = prg->msgs;
+	if (!msg)
+		return;
+	while (*msg != '\0') {
+		const char *end = strchr(msg, '\n');
+		size_t len = (end != NULL) ? (size_t) (end - msg) : strlen(msg);
+		fprintf(stderr, "%s:%.*s\n", prg->name, (int) len, msg);
+		msg += len + (end != NULL);
+	}
+}
+
+/**
+ * Print a line of memory statistics for a pipeline stage,
+ * indented to follow a header line.
+ */
+void SAU_print_mem_stats(const char *restrict label,
+		const SAU_MemPoolStats *restrict stats) {
+	fprintf(stdout,
+		"\t%s\t%zu used (%zu requested), %zu reserved in %zu blocks, %zu wasted\n",
+		label, stats->used, stats->requested,
+		stats->reserved, stats->blocks, stats->waste);
+}
+
+/*
+ * Print memory statistics for the stages of building a program,
+ * for script data \p sd and/or program \p prg, if not NULL.
+ */
+static void print_build_mem_stats(const SAU_Script *restrict sd,
+		const SAU_Program *restrict prg) {
+	SAU_MemPoolStats stats;
+	fprintf(stdout, "Memory: \"%s\"\n",
+			(sd != NULL) ? sd->name : prg->name);
+	if (sd != NULL) {
+		SAU_print_mem_stats("Parser: ", &sd->parse_mem);
+		SAU_MemPool_get_stats(sd->mem, &stats);
+		SAU_print_mem_stats("Script: ", &stats);
+	}
+	if (prg != NULL) {
+		SAU_MemPool_get_stats(prg->mem, &stats);
+		SAU_print_mem_stats("Program:", &stats);
+	}
+}
+
+/*
+ * Create program for the given script file, or string if \p is_path
+ * is false, optionally printing memory statistics. Invokes the parser.
  *
  * \return instance or NULL on error
  */
-static SAU_Program *build_program(const char *restrict script_arg,
-		bool is_path) {
+static SAU_Program *load_program(const char *restrict script_arg,
+		bool is_path, bool mem_stats) {
 	SAU_Script *sd = SAU_load_Script(script_arg, is_path);
 	if (!sd)
 		return NULL;
+	uint64_t t = SAU_Trace_begin();
 	SAU_Program *o = SAU_build_Program(sd);
+	SAU_Trace_end(t, "build", "build", is_path ? script_arg : NULL);
+	if (mem_stats)
+		print_build_mem_stats(sd, o);
 	SAU_discard_Script(sd);
 	return o;
 }
 
+/**
+ * Create program for the given script file, or string if \p is_path
+ * is false. Invokes the parser.
+ *
+ * \return instance or NULL on error
+ */
+SAU_Program *SAU_load_Program(const char *restrict script_arg,
+		bool is_path) {
+	return load_program(script_arg, is_path, false);
+}
+
+/*
+ * Create program for the given script file. Invokes the parser.
+ *
+ * If \p cache_dir is not NULL, a program cache file for the script
+ * contents is used if present, skipping the parser, or else written.
+ * The messages printed by the parser are kept and printed again.
+ *
+ * \return instance or NULL on error
+ */
+static SAU_Program *build_program(const char *restrict script_arg,
+		bool is_path, const char *restrict cache_dir,
+		bool mem_stats) {
+	SAU_ProgramSrcKey key;
+	char *cache_path = NULL;
+	SAU_Program *o;
+	if (cache_dir != NULL &&
+	    get_script_key(&key, script_arg, is_path)) {
+		cache_path = get_cache_path(cache_dir, &key);
+		FILE *f = (cache_path != NULL) ? fopen(cache_path, "rb") : NULL;
+		if (f != NULL) {
+			uint64_t t = SAU_Trace_begin();
+			o = SAU_read_Program(f, &key,
+					is_path ? script_arg : "<string>");
+			fclose(f);
+			SAU_Trace_end(t, "build", "cache read",
+					is_path ? script_arg : NULL);
+			if (o != NULL) {
+				print_build_msgs(o);
+				if (mem_stats)
+					print_build_mem_stats(NULL, o);
+				goto DONE;
+			}
+		}
+	}
+	o = load_program(script_arg, is_path, mem_stats);
+	if (o != NULL && cache_path != NULL)
+		write_cache(o, &key, cache_path);
+DONE:
+	free(cache_path);
+	return o;
+}
+
 /**
  * Build the listed scripts, adding each result (even if NULL)
  * to the program list.
  *
+ * If \p cache_dir is not NULL, it is used for program cache files,
+ * unless only checking scripts.
+ *
  * \return number of programs successfully built
  */
 size_t SAU_build(const SAU_PtrArr *restrict script_args, uint32_t options,
-		SAU_PtrArr *restrict prg_objs) {
+		SAU_PtrArr *restrict prg_objs, const char *restrict cache_dir) {
 	bool are_paths = !(options & SAU_ARG_EVAL_STRING);
+	bool mem_stats = (options & SAU_ARG_MEM_STATS) != 0;
+	if ((options & SAU_ARG_MODE_CHECK) != 0)
+		cache_dir = NULL;
 	size_t built = 0;
 	const char **args = (const char**) SAU_PtrArr_ITEMS(script_args);
 	for (size_t i = 0; i < script_args->count; ++i) {
-		SAU_Program *prg = build_program(args[i], are_paths);
+		SAU_Program *prg = build_program(args[i], are_paths,
+				cache_dir, mem_stats);
 		if (prg != NULL) ++built;
 		SAU_PtrArr_add(prg_objs, prg);
 	}
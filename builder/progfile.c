@@ -0,0 +1,458 @@
+/* saugns: Audio program file writer and reader.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "../program.h"
+#include "../arrtype.h"
+#include "../mempool.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Program files hold an image of the program data, laid out as in
+ * memory but with each pointer replaced by an offset into the image.
+ * Offset 0 is the program header, and is used for NULL. Reading a file
+ * takes a single allocation, the offsets turned back into pointers.
+ *
+ * The image is not used in place, e.g. from a mapping of the file:
+ * the program is used through pointers, so every event and node is
+ * written to when relocating, and a private mapping would copy all
+ * of its pages anyway. Using the offsets directly would take changing
+ * how all stages access program data.
+ *
+ * The layout is that of the build which wrote the file, so sizes are
+ * stored in the file header and checked. So is the key of the script
+ * it was built from, and all values used as indices when running.
+ * The messages printed when building are kept, to print on reading.
+ */
+
+#define PRGFILE_MAGIC "SAUP"
+#define PRGFILE_VERSION 7
+
+#define ALIGN_BYTES      sizeof(void*)
+#define ALIGN_SIZE(size) (((size) + (ALIGN_BYTES - 1)) & ~(ALIGN_BYTES - 1))
+
+typedef struct FileHead {
+	char magic[4];
+	uint32_t version;
+	uint32_t ptr_size;
+	uint32_t prg_size;
+	uint32_t ev_size;
+	uint32_t vd_size;
+	uint32_t od_size;
+	uint32_t img_size;
+	SAU_ProgramSrcKey src;
+} FileHead;
+
+static void init_FileHead(FileHead *restrict h, size_t img_size,
+		const SAU_ProgramSrcKey *restrict key) {
+	*h = (FileHead){0};
+	memcpy(h->magic, PRGFILE_MAGIC, sizeof(h->magic));
+	h->version = PRGFILE_VERSION;
+	h->ptr_size = sizeof(void*);
+	h->prg_size = sizeof(SAU_Program);
+	h->ev_size = sizeof(SAU_ProgramEvent);
+	h->vd_size = sizeof(SAU_ProgramVoData);
+	h->od_size = sizeof(SAU_ProgramOpData);
+	h->img_size = img_size;
+	h->src = *key;
+}
+
+/*
+ * Map from data written to its offset, for shared op lists
+ * and references back to earlier voice and operator data.
+ */
+typedef struct OffsMapItem {
+	const void *ptr;
+	size_t offs;
+} OffsMapItem;
+
+typedef struct OffsMap {
+	OffsMapItem *a;
+	size_t count, alloc;
+} OffsMap;
+
+static size_t OffsMap_hash(const OffsMap *restrict o, const void *ptr) {
+	uintptr_t i = (uintptr_t) ptr;
+	return ((i >> 3) * 2654435761U) & (o->alloc - 1);
+}
+
+/*
+ * \return offset, or 0 if not found
+ */
+static size_t OffsMap_get(const OffsMap *restrict o, const void *ptr) {
+	if (!o->alloc)
+		return 0;
+	for (size_t i = OffsMap_hash(o, ptr);; i = (i + 1) & (o->alloc - 1)) {
+		if (o->a[i].ptr == ptr)
+			return o->a[i].offs;
+		if (!o->a[i].ptr)
+			return 0;
+	}
+}
+
+/*
+ * \return true, or false on allocation failure
+ */
+static bool OffsMap_set(OffsMap *restrict o, const void *ptr, size_t offs) {
+	if (o->count >= o->alloc / 2) {
+		OffsMap old = *o;
+		o->alloc = (old.alloc > 0) ? old.alloc * 2 : 256;
+		o->a = calloc(o->alloc, sizeof(OffsMapItem));
+		if (!o->a) {
+			*o = old;
+			return false;
+		}
+		o->count = 0;
+		for (size_t i = 0; i < old.alloc; ++i)
+			if (old.a[i].ptr != NULL)
+				OffsMap_set(o, old.a[i].ptr, old.a[i].offs);
+		free(old.a);
+	}
+	size_t i = OffsMap_hash(o, ptr);
+	while (o->a[i].ptr != NULL && o->a[i].ptr != ptr)
+		i = (i + 1) & (o->alloc - 1);
+	if (!o->a[i].ptr) ++o->count;
+	o->a[i].ptr = ptr;
+	o->a[i].offs = offs;
+	return true;
+}
+
+typedef struct PrgWriter {
+	SAU_ByteArr img;
+	OffsMap map;
+} PrgWriter;
+
+/*
+ * Append copy of \p src to image, aligned, setting \p offs to its offset.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool PrgWriter_put(PrgWriter *restrict o,
+		const void *restrict src, size_t size, size_t *restrict offs) {
+	size_t start = ALIGN_SIZE(o->img.count);
+	if (!SAU_ByteArr_upsize(&o->img, start + size))
+		return false;
+	memset(&o->img.a[o->img.count], 0, start - o->img.count);
+	if (src != NULL)
+		memcpy(&o->img.a[start], src, size);
+	else
+		memset(&o->img.a[start], 0, size);
+	o->img.count = start + size;
+	*offs = start;
+	return true;
+}
+
+/*
+ * Set pointer-sized field at \p at in image to offset \p offs.
+ */
+static void PrgWriter_set_ref(PrgWriter *restrict o, size_t at, size_t offs) {
+	uintptr_t ref = offs;
+	memcpy(&o->img.a[at], &ref, sizeof(ref));
+}
+
+/*
+ * Set field at \p at to the offset of \p list, adding it if new.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool PrgWriter_ref_list(PrgWriter *restrict o, size_t at,
+		const SAU_ProgramOpList *restrict list) {
+	size_t offs = 0;
+	if (list != NULL && !(offs = OffsMap_get(&o->map, list))) {
+		if (!PrgWriter_put(o, list, sizeof(SAU_ProgramOpList) +
+					sizeof(uint32_t) * list->count, &offs) ||
+		    !OffsMap_set(&o->map, list, offs))
+			return false;
+	}
+	PrgWriter_set_ref(o, at, offs);
+	return true;
+}
+
+/*
+ * Add data for event \p ev, already copied at \p ev_offs.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool PrgWriter_put_event(PrgWriter *restrict o,
+		const SAU_ProgramEvent *restrict ev, size_t ev_offs) {
+	size_t offs;
+	if (ev->vo_data != NULL) {
+		const SAU_ProgramVoData *vd = ev->vo_data;
+		if (!PrgWriter_put(o, vd, sizeof(*vd), &offs) ||
+		    !OffsMap_set(&o->map, vd, offs))
+			return false;
+		PrgWriter_set_ref(o, ev_offs +
+				offsetof(SAU_ProgramEvent, vo_data), offs);
+		PrgWriter_set_ref(o, offs +
+				offsetof(SAU_ProgramVoData, prev),
+				OffsMap_get(&o->map, vd->prev));
+		if (!PrgWriter_ref_list(o, offs +
+				offsetof(SAU_ProgramVoData, carriers),
+				vd->carriers))
+			return false;
+	}
+	if (ev->op_data_count > 0) {
+		/*
+		 * Operator data for an event is laid out contiguously,
+		 * each node sized for the parameter values it holds.
+		 */
+		const SAU_ProgramOpData *op_data = ev->op_data, *od;
+		size_t size = 0;
+		od = op_data;
+		for (size_t i = 0; i < ev->op_data_count; ++i) {
+			size += SAU_ProgramOpData_size(od->params);
+			od = SAU_ProgramOpData_next(od);
+		}
+		if (!PrgWriter_put(o, op_data, size, &offs))
+			return false;
+		PrgWriter_set_ref(o, ev_offs +
+				offsetof(SAU_ProgramEvent, op_data), offs);
+		od = op_data;
+		for (size_t i = 0; i < ev->op_data_count;
+				++i, od = SAU_ProgramOpData_next(od)) {
+			size_t od_offs = offs +
+				((const uint8_t*) od - (const uint8_t*) op_data);
+			if (!OffsMap_set(&o->map, od, od_offs))
+				return false;
+			PrgWriter_set_ref(o, od_offs +
+					offsetof(SAU_ProgramOpData, prev),
+					OffsMap_get(&o->map, od->prev));
+			if (!PrgWriter_ref_list(o, od_offs +
+				offsetof(SAU_ProgramOpData, fmods), od->fmods) ||
+			    !PrgWriter_ref_list(o, od_offs +
+				offsetof(SAU_ProgramOpData, pmods), od->pmods) ||
+			    !PrgWriter_ref_list(o, od_offs +
+				offsetof(SAU_ProgramOpData, amods), od->amods))
+				return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Write program to file, for reading back with SAU_read_Program(),
+ * marked as built from the script contents identified by \p key.
+ *
+ * \return true unless allocation or write failed
+ */
+bool SAU_Program_write(const SAU_Program *restrict o,
+		const SAU_ProgramSrcKey *restrict key, FILE *restrict f) {
+	PrgWriter pw = (PrgWriter){0};
+	SAU_Program prg = *o;
+	size_t prg_offs, evs_offs;
+	bool ok = false;
+	prg.name = NULL;
+	prg.msgs = NULL;
+	prg.mem = NULL;
+	if (!PrgWriter_put(&pw, &prg, sizeof(prg), &prg_offs) ||
+	    !PrgWriter_put(&pw, o->events,
+			sizeof(SAU_ProgramEvent) * o->ev_count, &evs_offs))
+		goto DONE;
+	PrgWriter_set_ref(&pw, prg_offs + offsetof(SAU_Program, events),
+			evs_offs);
+	if (o->msgs != NULL) {
+		size_t msgs_offs;
+		if (!PrgWriter_put(&pw, o->msgs, strlen(o->msgs) + 1,
+				&msgs_offs))
+			goto DONE;
+		PrgWriter_set_ref(&pw, prg_offs + offsetof(SAU_Program, msgs),
+				msgs_offs);
+	}
+	for (size_t i = 0; i < o->ev_count; ++i) {
+		if (!PrgWriter_put_event(&pw, &o->events[i],
+				evs_offs + sizeof(SAU_ProgramEvent) * i))
+			goto DONE;
+	}
+	if (pw.img.count > UINT32_MAX)
+		goto DONE;
+	FileHead h;
+	init_FileHead(&h, pw.img.count, key);
+	ok = (fwrite(&h, sizeof(h), 1, f) == 1) &&
+		(fwrite(pw.img.a, pw.img.count, 1, f) == 1);
+DONE:
+	SAU_ByteArr_clear(&pw.img);
+	free(pw.map.a);
+	return ok;
+}
+
+/*
+ * Turn offset in pointer-sized field at \p field into pointer,
+ * checking that \p size bytes fit within the image.
+ *
+ * \return pointer set, or NULL if offset 0 or out of bounds
+ */
+static void *reloc(uint8_t *restrict img, size_t img_size,
+		void *restrict field, size_t size, bool *restrict error) {
+	uintptr_t offs;
+	void *ptr = NULL;
+	memcpy(&offs, field, sizeof(offs));
+	if (offs != 0) {
+		if (offs > img_size || img_size - offs < size ||
+				(offs % ALIGN_BYTES) != 0)
+			*error = true;
+		else
+			ptr = img + offs;
+	}
+	memcpy(field, &ptr, sizeof(ptr));
+	return ptr;
+}
+
+static void reloc_list(uint8_t *restrict img, size_t img_size,
+		void *restrict field, uint32_t op_count, bool *restrict error) {
+	SAU_ProgramOpList *list = reloc(img, img_size, field,
+			sizeof(SAU_ProgramOpList), error);
+	if (!list)
+		return;
+	size_t offs = (uint8_t*) list - img;
+	if ((img_size - offs - sizeof(SAU_ProgramOpList)) / sizeof(uint32_t)
+			< list->count) {
+		*error = true;
+		return;
+	}
+	for (uint32_t i = 0; i < list->count; ++i)
+		if (list->ids[i] >= op_count) *error = true;
+}
+
+/*
+ * \return true if ramp at \p v has a valid type and flags
+ */
+static bool check_ramp(const void *restrict v) {
+	SAU_Ramp ramp;
+	memcpy(&ramp, v, sizeof(ramp));
+	return ramp.type < SAU_RAMP_TYPES &&
+		(ramp.flags & ~((SAU_RAMPP_TIME << 1) - 1)) == 0;
+}
+
+/*
+ * Check the values of operator data which are used as indices
+ * when running.
+ *
+ * \return true unless invalid data found
+ */
+static bool check_op_values(const SAU_ProgramOpData *restrict od) {
+	uint32_t params = od->params;
+	if (params & SAU_POPP_WAVE) {
+		uint32_t wave;
+		memcpy(&wave, SAU_ProgramOpData_VALUE(od, SAU_POPP_WAVE),
+				sizeof(wave));
+		if (wave >= SAU_WAVE_TYPES)
+			return false;
+	}
+	if (((params & SAU_POPP_FREQ) &&
+	     !check_ramp(SAU_ProgramOpData_VALUE(od, SAU_POPP_FREQ))) ||
+	    ((params & SAU_POPP_FREQ2) &&
+	     !check_ramp(SAU_ProgramOpData_VALUE(od, SAU_POPP_FREQ2))) ||
+	    ((params & SAU_POPP_AMP) &&
+	     !check_ramp(SAU_ProgramOpData_VALUE(od, SAU_POPP_AMP))) ||
+	    ((params & SAU_POPP_AMP2) &&
+	     !check_ramp(SAU_ProgramOpData_VALUE(od, SAU_POPP_AMP2))))
+		return false;
+	return true;
+}
+
+/*
+ * Relocate pointers for program image, checking them.
+ *
+ * \return true unless invalid data found
+ */
+static bool reloc_program(uint8_t *restrict img, size_t img_size) {
+	SAU_Program *prg = (SAU_Program*) img;
+	bool error = false;
+	if (prg->ev_count > (img_size / sizeof(SAU_ProgramEvent)))
+		return false;
+	SAU_ProgramEvent *events = reloc(img, img_size, &prg->events,
+			sizeof(*events) * prg->ev_count, &error);
+	if (error || (!events && prg->ev_count > 0))
+		return false;
+	const char *msgs = reloc(img, img_size, &prg->msgs, 1, &error);
+	if (msgs != NULL && !memchr(msgs, '\0',
+				img_size - ((const uint8_t*) msgs - img)))
+		return false;
+	for (size_t i = 0; i < prg->ev_count && !error; ++i) {
+		SAU_ProgramEvent *ev = &events[i];
+		if (ev->vo_id >= prg->vo_count && ev->vo_id != SAU_PVO_NO_ID)
+			return false;
+		SAU_ProgramVoData *vd = reloc(img, img_size, &ev->vo_data,
+				sizeof(*vd), &error);
+		if (vd != NULL) {
+			if ((vd->params & ~SAU_PVO_PARAMS) != 0 ||
+			    ((vd->params & SAU_PVOP_PAN) != 0 &&
+			     !check_ramp(&vd->pan)))
+				return false;
+			reloc(img, img_size, &vd->prev, sizeof(*vd), &error);
+			reloc_list(img, img_size, &vd->carriers,
+					prg->op_count, &error);
+			if (!vd->carriers && (vd->params & SAU_PVOP_GRAPH))
+				return false;
+		}
+		if (ev->op_data_count > (img_size / sizeof(SAU_ProgramOpData)))
+			return false;
+		SAU_ProgramOpData *od = reloc(img, img_size, &ev->op_data,
+				sizeof(*od), &error);
+		if (!od && ev->op_data_count > 0)
+			return false;
+		for (size_t j = 0; j < ev->op_data_count; ++j) {
+			size_t offs = (uint8_t*) od - img;
+			if (img_size - offs < sizeof(*od) ||
+			    (od->params & ~(SAU_POP_PARAMS | SAU_POPF_MUTE)) != 0 ||
+			    img_size - offs < SAU_ProgramOpData_size(od->params))
+				return false;
+			if (od->id >= prg->op_count || !check_op_values(od))
+				return false;
+			reloc(img, img_size, &od->prev, sizeof(*od), &error);
+			reloc_list(img, img_size, &od->fmods,
+					prg->op_count, &error);
+			reloc_list(img, img_size, &od->pmods,
+					prg->op_count, &error);
+			reloc_list(img, img_size, &od->amods,
+					prg->op_count, &error);
+			if (!od->fmods || !od->pmods || !od->amods)
+				return false;
+			od = (SAU_ProgramOpData*) ((uint8_t*) od +
+					SAU_ProgramOpData_size(od->params));
+		}
+	}
+	return !error;
+}
+
+/**
+ * Read program written using SAU_Program_write() from file,
+ * giving it \p name.
+ *
+ * \return instance or NULL on error, including if the file
+ *         was written by an incompatible build, or for script
+ *         contents other than those identified by \p key
+ */
+SAU_Program *SAU_read_Program(FILE *restrict f,
+		const SAU_ProgramSrcKey *restrict key,
+		const char *restrict name) {
+	FileHead h, cmp;
+	if (fread(&h, sizeof(h), 1, f) != 1)
+		return NULL;
+	init_FileHead(&cmp, h.img_size, key);
+	if (memcmp(&h, &cmp, sizeof(h)) != 0 || h.img_size < sizeof(SAU_Program))
+		return NULL;
+	SAU_MemPool *mem = SAU_obtain_MemPool(0);
+	if (!mem)
+		return NULL;
+	uint8_t *img = SAU_MemPool_alloc(mem, h.img_size);
+	if (!img || fread(img, h.img_size, 1, f) != 1 ||
+			!reloc_program(img, h.img_size)) {
+		SAU_release_MemPool(mem);
+		return NULL;
+	}
+	SAU_Program *o = (SAU_Program*) img;
+	o->name = name;
+	o->mem = mem;
+	return o;
+}
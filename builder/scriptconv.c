@@ -12,8 +12,9 @@
  */
 
 #include "scriptconv.h"
-#include "../ptrarr.h"
+#include "../reader/symtab.h"
 #include <stdio.h>
+#include <string.h>
 
 /*
  * Program construction from script data.
@@ -23,26 +24,6 @@
 
 static const SAU_ProgramOpList blank_oplist = {0};
 
-static sauNoinline const SAU_ProgramOpList
-*create_ProgramOpList(const SAU_RefList *restrict op_list,
-		SAU_MemPool *restrict mem) {
-	size_t count = op_list->ref_count;
-	if (!count)
-		return &blank_oplist;
-	SAU_ProgramOpList *o = SAU_MemPool_alloc(mem,
-			sizeof(SAU_ProgramOpList) + sizeof(uint32_t) * count);
-	if (!o)
-		return NULL;
-	o->count = count;
-	size_t i = 0;
-	for (SAU_RefItem *ref = op_list->refs;
-			ref != NULL; ref = ref->next) {
-		SAU_ScriptOpData *op = ref->data;
-		o->ids[i++] = op->op_id;
-	}
-	return o;
-}
-
 /*
  * Returns the longest carrier duration for the voice event.
  */
@@ -59,6 +40,57 @@ static uint32_t voice_duration(const SAU_ScriptEvData *restrict ve) {
 	return duration_ms;
 }
 
+/*
+ * Compare heap items, ordering by key, then by ID.
+ */
+static inline bool SAU_IdHeapItem_less(const SAU_IdHeapItem *restrict a,
+		const SAU_IdHeapItem *restrict b) {
+	return (a->key < b->key) || (a->key == b->key && a->id < b->id);
+}
+
+/*
+ * Add item to heap.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool SAU_IdHeap_push(SAU_IdHeap *restrict o,
+		uint32_t key, uint32_t id) {
+	if (!_SAU_IdHeap_add(o, NULL))
+		return false;
+	SAU_IdHeapItem item = {key, id};
+	size_t i = o->count - 1;
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (!SAU_IdHeapItem_less(&item, &o->a[parent]))
+			break;
+		o->a[i] = o->a[parent];
+		i = parent;
+	}
+	o->a[i] = item;
+	return true;
+}
+
+/*
+ * Remove first item from non-empty heap.
+ */
+static void SAU_IdHeap_pop(SAU_IdHeap *restrict o) {
+	SAU_IdHeapItem item = o->a[--o->count];
+	size_t i = 0;
+	for (;;) {
+		size_t child = i * 2 + 1;
+		if (child >= o->count)
+			break;
+		if (child + 1 < o->count &&
+		    SAU_IdHeapItem_less(&o->a[child + 1], &o->a[child]))
+			++child;
+		if (!SAU_IdHeapItem_less(&o->a[child], &item))
+			break;
+		o->a[i] = o->a[child];
+		i = child;
+	}
+	o->a[i] = item;
+}
+
 /*
  * Get voice ID for event, setting it to \p vo_id.
  *
@@ -71,19 +103,19 @@ static bool SAU_VoAlloc_get_id(SAU_VoAlloc *restrict va,
 		return true;
 	}
 	SAU_VoAllocState *vas;
-	for (size_t id = 0; id < va->count; ++id) {
-		vas = &va->a[id];
-		if (!vas->last_sev->next_vo_use
-			&& vas->duration_ms == 0) {
-			*vas = (SAU_VoAllocState){0};
-			*vo_id = id;
-			goto INIT;
-		}
+	if (va->free.count > 0) {
+		*vo_id = va->free.a[0].id;
+		SAU_IdHeap_pop(&va->free);
+		vas = &va->vas.a[*vo_id];
+		SAU_IdArr op_ids = vas->op_ids;
+		*vas = (SAU_VoAllocState){0};
+		vas->op_ids = op_ids;
+		goto INIT;
 	}
-	*vo_id = va->count;
-	if (!_SAU_VoAlloc_add(va, NULL))
+	*vo_id = va->vas.count;
+	if (!_SAU_VoAllocStateArr_add(&va->vas, NULL))
 		return false;
-	vas = &va->a[*vo_id];
+	vas = &va->vas.a[*vo_id];
 INIT:
 	vas->carriers = &blank_oplist;
 	return true;
@@ -99,20 +131,35 @@ INIT:
  */
 static bool SAU_VoAlloc_update(SAU_VoAlloc *restrict va,
 		SAU_ScriptEvData *restrict e, uint32_t *restrict vo_id) {
-	for (size_t id = 0; id < va->count; ++id) {
-		if (va->a[id].duration_ms < e->wait_ms)
-			va->a[id].duration_ms = 0;
-		else
-			va->a[id].duration_ms -= e->wait_ms;
+	va->time_ms += e->wait_ms;
+	while (va->expiring.count > 0 &&
+	       va->expiring.a[0].key <= va->time_ms) {
+		uint32_t id = va->expiring.a[0].id;
+		SAU_IdHeap_pop(&va->expiring);
+		if (!SAU_IdHeap_push(&va->free, 0, id))
+			return false;
 	}
 	if (!SAU_VoAlloc_get_id(va, e, vo_id))
 		return false;
 	e->vo_id = *vo_id;
-	SAU_VoAllocState *vas = &va->a[*vo_id];
+	SAU_VoAllocState *vas = &va->vas.a[*vo_id];
 	vas->last_sev = e;
 	vas->flags &= ~SAU_VAS_GRAPH;
 	if (e->ev_flags & SAU_SDEV_NEW_OPGRAPH)
-		vas->duration_ms = voice_duration(e);
+		vas->end_ms = va->time_ms + voice_duration(e);
+	if (!e->next_vo_use) {
+		/*
+		 * Last use of voice; free it once it's done playing.
+		 */
+		if (vas->end_ms <= va->time_ms) {
+			if (!SAU_IdHeap_push(&va->free, 0, *vo_id))
+				return false;
+		} else {
+			if (!SAU_IdHeap_push(&va->expiring,
+						vas->end_ms, *vo_id))
+				return false;
+		}
+	}
 	return true;
 }
 
@@ -120,13 +167,16 @@ static bool SAU_VoAlloc_update(SAU_VoAlloc *restrict va,
  * Clear voice allocator.
  */
 static void SAU_VoAlloc_clear(SAU_VoAlloc *restrict o) {
-	_SAU_VoAlloc_clear(o);
+	for (size_t i = 0; i < o->vas.count; ++i)
+		_SAU_IdArr_clear(&o->vas.a[i].op_ids);
+	_SAU_VoAllocStateArr_clear(&o->vas);
+	_SAU_IdHeap_clear(&o->expiring);
+	_SAU_IdHeap_clear(&o->free);
+	o->time_ms = 0;
 }
 
 /*
  * Get operator ID for event, setting it to \p op_id.
- * (Tracking of expired operators for reuse of their IDs is currently
- * disabled.)
  *
  * \return true, or false on allocation failure
  */
@@ -137,20 +187,18 @@ static bool SAU_OpAlloc_get_id(SAU_OpAlloc *restrict oa,
 		return true;
 	}
 	SAU_OpAllocState *oas;
-//	for (uint32_t id = 0; id < oa->count; ++id) {
-//		oas = &oa->a[id];
-//		if (!oas->last_sod->next_use
-//			&& oas->duration_ms == 0) {
-//			*oas = (SAU_OpAllocState){0};
-//			*op_id = id;
-//			goto INIT;
-//		}
-//	}
-	*op_id = oa->count;
-	if (!_SAU_OpAlloc_add(oa, NULL))
+	if (oa->free.count > 0) {
+		*op_id = oa->free.a[0].id;
+		SAU_IdHeap_pop(&oa->free);
+		oas = &oa->oas.a[*op_id];
+		*oas = (SAU_OpAllocState){0};
+		goto INIT;
+	}
+	*op_id = oa->oas.count;
+	if (!_SAU_OpAllocStateArr_add(&oa->oas, NULL))
 		return false;
-	oas = &oa->a[*op_id];
-//INIT:
+	oas = &oa->oas.a[*op_id];
+INIT:
 	for (size_t i = 0; i < SAU_POP_USES - 1; ++i)
 		oas->mod_lists[i] = &blank_oplist;
 	return true;
@@ -159,9 +207,8 @@ static bool SAU_OpAlloc_get_id(SAU_OpAlloc *restrict oa,
 /*
  * Update operators for event and return an operator ID for the event.
  *
- * Use the current operator if any, otherwise allocating a new one.
- * (Tracking of expired operators for reuse of their IDs is currently
- * disabled.)
+ * Use the current operator if any, otherwise reusing a freed operator
+ * if possible, or allocating a new if not.
  *
  * Only valid to call for single-operator nodes.
  *
@@ -170,20 +217,122 @@ static bool SAU_OpAlloc_get_id(SAU_OpAlloc *restrict oa,
 static bool SAU_OpAlloc_update(SAU_OpAlloc *restrict oa,
 		SAU_ScriptOpData *restrict od,
 		uint32_t *restrict op_id) {
-//	SAU_ScriptEvData *e = od->event;
-//	for (size_t id = 0; id < oa->count; ++id) {
-//		if (oa->a[id].duration_ms < e->wait_ms)
-//			oa->a[id].duration_ms = 0;
-//		else
-//			oa->a[id].duration_ms -= e->wait_ms;
-//	}
 	if (!SAU_OpAlloc_get_id(oa, od, op_id))
 		return false;
 	od->op_id = *op_id;
-	SAU_OpAllocState *oas = &oa->a[*op_id];
+	SAU_OpAllocState *oas = &oa->oas.a[*op_id];
 	oas->last_sod = od;
-	oas->flags = 0;
-//	oas->duration_ms = od->time.v_ms;
+	return true;
+}
+
+/*
+ * Check ramp parameter update in \p od against known current value,
+ * and track the value.
+ *
+ * \return true if the update changes nothing
+ */
+static bool SAU_OpAllocState_prune_ramp(SAU_OpAllocState *restrict oas,
+		uint32_t param, SAU_Ramp *restrict cur,
+		const SAU_ScriptOpData *restrict od) {
+	const SAU_Ramp *src = (const SAU_Ramp*)
+		SAU_ScriptOpData_VALUE(od, param);
+	if (src->flags & SAU_RAMPP_GOAL) {
+		oas->known &= ~param;
+		oas->goals |= param;
+		return false;
+	}
+	if (!(src->flags & SAU_RAMPP_STATE))
+		return false;
+	if ((oas->known & param) != 0 && cur->v0 == src->v0 &&
+	    !((cur->flags ^ src->flags) & SAU_RAMPP_STATE_RATIO))
+		return true;
+	*cur = *src;
+	if (!(oas->goals & param))
+		oas->known |= param;
+	return false;
+}
+
+/*
+ * Remove parameter updates for operator which set values already
+ * current, i.e. last set the same way, without a goal set since the
+ * operator was new. Tracks the values set.
+ *
+ * Updates which restart something (time, silence, phase) are kept.
+ *
+ * \return parameters remaining
+ */
+static uint32_t SAU_OpAlloc_prune(SAU_OpAlloc *restrict oa,
+		const SAU_ScriptOpData *restrict od, uint32_t op_id) {
+	SAU_OpAllocState *oas = &oa->oas.a[op_id];
+	uint32_t params = od->op_params & SAU_POP_PARAMS;
+	if (!od->prev_use) {
+		oas->known = 0;
+		oas->goals = 0;
+	}
+	if (params & SAU_POPP_WAVE) {
+		uint32_t wave = *(uint32_t*) SAU_ScriptOpData_VALUE(od,
+				SAU_POPP_WAVE);
+		if ((oas->known & SAU_POPP_WAVE) != 0 && oas->wave == wave)
+			params &= ~SAU_POPP_WAVE;
+		oas->wave = wave;
+		oas->known |= SAU_POPP_WAVE;
+	}
+	if ((params & SAU_POPP_FREQ) != 0 && SAU_OpAllocState_prune_ramp(oas,
+				SAU_POPP_FREQ, &oas->freq, od))
+		params &= ~SAU_POPP_FREQ;
+	if ((params & SAU_POPP_FREQ2) != 0 && SAU_OpAllocState_prune_ramp(oas,
+				SAU_POPP_FREQ2, &oas->freq2, od))
+		params &= ~SAU_POPP_FREQ2;
+	if ((params & SAU_POPP_AMP) != 0 && SAU_OpAllocState_prune_ramp(oas,
+				SAU_POPP_AMP, &oas->amp, od))
+		params &= ~SAU_POPP_AMP;
+	if ((params & SAU_POPP_AMP2) != 0 && SAU_OpAllocState_prune_ramp(oas,
+				SAU_POPP_AMP2, &oas->amp2, od))
+		params &= ~SAU_POPP_AMP2;
+	return params;
+}
+
+/*
+ * Mark operators in list, and those reached through them, as reachable.
+ */
+static void SAU_OpAlloc_mark_list(SAU_OpAlloc *restrict oa,
+		const SAU_ProgramOpList *restrict op_list) {
+	for (uint32_t i = 0; i < op_list->count; ++i) {
+		SAU_OpAllocState *oas = &oa->oas.a[op_list->ids[i]];
+		if (oas->mark == oa->mark)
+			continue;
+		oas->mark = oa->mark;
+		for (size_t j = 0; j < SAU_POP_USES - 1; ++j)
+			SAU_OpAlloc_mark_list(oa, oas->mod_lists[j]);
+	}
+}
+
+/*
+ * Free the operators created for a voice ID which are no longer
+ * reachable from its carriers, and not used in any later event.
+ * To be called when the voice graph is replaced.
+ *
+ * Modulators with infinite time live as long as they're linked,
+ * and voice ID reuse frees the operators of the old voice.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool SAU_OpAlloc_collect(SAU_OpAlloc *restrict oa,
+		SAU_VoAllocState *restrict vas) {
+	++oa->mark;
+	SAU_OpAlloc_mark_list(oa, vas->carriers);
+	size_t kept = 0;
+	for (size_t i = 0; i < vas->op_ids.count; ++i) {
+		uint32_t id = vas->op_ids.a[i];
+		SAU_OpAllocState *oas = &oa->oas.a[id];
+		if (oas->mark == oa->mark || oas->last_sod->next_use != NULL) {
+			vas->op_ids.a[kept++] = id;
+			continue;
+		}
+		if (!SAU_IdHeap_push(&oa->free, 0, id))
+			return false;
+	}
+	vas->op_ids.count = kept;
 	return true;
 }
 
@@ -191,54 +340,125 @@ static bool SAU_OpAlloc_update(SAU_OpAlloc *restrict oa,
  * Clear operator allocator.
  */
 static void SAU_OpAlloc_clear(SAU_OpAlloc *restrict o) {
-	_SAU_OpAlloc_clear(o);
+	_SAU_OpAllocStateArr_clear(&o->oas);
+	_SAU_IdHeap_clear(&o->free);
+	o->mark = 0;
 }
 
-sauArrType(OpDataArr, SAU_ProgramOpData, _)
+sauArrType(ProgramEventArr, SAU_ProgramEvent, _)
+sauArrType(OffsArr, size_t, _)
 
+/*
+ * Events and operator data are added to arrays, copied to the program
+ * when done. Operator data, which varies in size, is laid out in a byte
+ * array, each node's offset kept; nodes are linked by index until done.
+ */
 typedef struct ScriptConv {
-	SAU_PtrArr ev_list;
+	ProgramEventArr ev_list;
 	SAU_VoAlloc va;
 	SAU_OpAlloc oa;
 	SAU_ProgramEvent *ev;
-	OpDataArr ev_op_data;
+	SAU_ByteArr op_data;
+	OffsArr od_offs;
+	SAU_IdArr od_prev;
+	SAU_IdArr list_buf;
+	SAU_ByteArr merge_buf;
+	OffsArr merge_offs;
+	SAU_IdArr merge_ids;
+	uint32_t list_count, list_uses;
+	uint32_t ev_merged, params_pruned;
+	uint32_t ops_unused, ops_muted;
+	bool ev_freed_ops;
 	uint32_t duration_ms;
 	SAU_MemPool *mem;
+	SAU_SymTab *lists;
 } ScriptConv;
 
+/*
+ * Add operator data node with space for values for \p params,
+ * zero-filled apart from the parameter flags.
+ *
+ * \return node, or NULL on allocation failure
+ */
+static SAU_ProgramOpData *ScriptConv_add_opnode(ScriptConv *restrict o,
+		uint32_t params) {
+	size_t offs = o->op_data.count;
+	size_t size = SAU_ProgramOpData_size(params);
+	if (!SAU_ByteArr_upsize(&o->op_data, offs + size) ||
+	    !_OffsArr_add(&o->od_offs, &offs))
+		return NULL;
+	o->op_data.count += size;
+	SAU_ProgramOpData *od = (SAU_ProgramOpData*) &o->op_data.a[offs];
+	memset(od, 0, size);
+	od->params = params;
+	return od;
+}
+
 /*
  * Convert data for an operator node to program operator data,
- * adding it to the list to be used for the current program event.
+ * adding it after that for earlier operators and events.
+ *
+ * Only the values for the parameters in \p params are stored.
  *
  * \return true, or false on allocation failure
  */
-static bool OpDataArr_add_for(OpDataArr *restrict o,
-		const SAU_ScriptOpData *restrict op, uint32_t op_id) {
-	SAU_ProgramOpData *od = _OpDataArr_add(o, NULL);
+static bool ScriptConv_add_opdata(ScriptConv *restrict o,
+		const SAU_ScriptOpData *restrict op, uint32_t op_id,
+		uint32_t params) {
+	SAU_ProgramOpData *od = ScriptConv_add_opnode(o, params);
 	if (!od)
 		return false;
 	od->id = op_id;
-	od->params = op->op_params;
 	od->time = op->time;
-	od->silence_ms = op->silence_ms;
-	od->wave = op->wave;
-	od->freq = op->freq;
-	od->freq2 = op->freq2;
-	od->amp = op->amp;
-	od->amp2 = op->amp2;
-	od->phase = op->phase;
+	SAU_POPV_copy(od->values, params, op->values, op->op_params);
 	return true;
 }
 
+/*
+ * Get program operator list for script data list, sharing storage
+ * for identical lists.
+ *
+ * \return instance, or NULL on allocation failure
+ */
+static sauNoinline const SAU_ProgramOpList
+*ScriptConv_get_oplist(ScriptConv *restrict o,
+		const SAU_RefList *restrict op_list) {
+	uint32_t count = op_list->ref_count;
+	if (!count)
+		return &blank_oplist;
+	/*
+	 * Lay out as SAU_ProgramOpList, i.e. count followed by IDs.
+	 */
+	o->list_buf.count = 0;
+	if (!_SAU_IdArr_add(&o->list_buf, &count))
+		return NULL;
+	for (SAU_RefItem *ref = op_list->refs;
+			ref != NULL; ref = ref->next) {
+		SAU_ScriptOpData *op = ref->data;
+		if (!_SAU_IdArr_add(&o->list_buf, &op->op_id))
+			return NULL;
+	}
+	SAU_SymStr *item = SAU_SymTab_get_symstr(o->lists, o->list_buf.a,
+			sizeof(uint32_t) * o->list_buf.count);
+	if (!item)
+		return NULL;
+	++o->list_uses;
+	if (!item->data) {
+		item->data = item; /* mark as counted */
+		++o->list_count;
+	}
+	return (const SAU_ProgramOpList*) item->key;
+}
+
 /*
  * Replace program operator list.
  *
  * \return true, or false on allocation failure
  */
-static inline bool update_oplist(const SAU_ProgramOpList **restrict dstp,
-		const SAU_RefList *restrict src,
-		SAU_MemPool *restrict mem) {
-	const SAU_ProgramOpList *dst = create_ProgramOpList(src, mem);
+static inline bool ScriptConv_update_oplist(ScriptConv *restrict o,
+		const SAU_ProgramOpList **restrict dstp,
+		const SAU_RefList *restrict src) {
+	const SAU_ProgramOpList *dst = ScriptConv_get_oplist(o, src);
 	if (!dst)
 		return false;
 	*dstp = dst;
@@ -254,18 +474,19 @@ static inline bool update_oplist(const SAU_ProgramOpList **restrict dstp,
  */
 static bool ScriptConv_update_modlists(ScriptConv *restrict o,
 		SAU_ProgramOpData *restrict od) {
-	SAU_OpAllocState *oas = &o->oa.a[od->id];
+	SAU_OpAllocState *oas = &o->oa.oas.a[od->id];
 	const SAU_ScriptOpData *sod = oas->last_sod;
 	const SAU_RefList *sub_lists[SAU_POP_USES - 1] = {0};
 	for (const SAU_RefList *list = sod->mod_lists;
 			list != NULL; list = list->next) {
 		sub_lists[list->list_type - 1] = list;
 	}
-	SAU_VoAllocState *vas = &o->va.a[o->ev->vo_id];
+	SAU_VoAllocState *vas = &o->va.vas.a[o->ev->vo_id];
 	for (size_t i = 0; i < SAU_POP_USES - 1; ++i) {
 		if (!sub_lists[i]) continue;
 		vas->flags |= SAU_VAS_GRAPH;
-		if (!update_oplist(&oas->mod_lists[i], sub_lists[i], o->mem))
+		if (!ScriptConv_update_oplist(o, &oas->mod_lists[i],
+					sub_lists[i]))
 			return false;
 	}
 	od->fmods = oas->mod_lists[SAU_POP_FMOD - 1];
@@ -287,28 +508,200 @@ static bool ScriptConv_convert_ops(ScriptConv *restrict o,
 	for (sop = sop_list->first; sop != NULL; sop = sop->range_next) {
 		uint32_t op_id;
 		if (!SAU_OpAlloc_update(&o->oa, sop, &op_id)) goto MEM_ERR;
-		if (!OpDataArr_add_for(&o->ev_op_data, sop, op_id))
+		if (!sop->prev_use) {
+			SAU_VoAllocState *vas = &o->va.vas.a[o->ev->vo_id];
+			if (!_SAU_IdArr_add(&vas->op_ids, &op_id))
+				goto MEM_ERR;
+		}
+		uint32_t params = SAU_OpAlloc_prune(&o->oa, sop, op_id);
+		uint32_t pruned = (sop->op_params & SAU_POP_PARAMS) & ~params;
+		for (uint32_t p = pruned; p != 0; p &= p - 1)
+			++o->params_pruned;
+		if (!ScriptConv_add_opdata(o, sop, op_id, params))
 			goto MEM_ERR;
 	}
-	if (o->ev_op_data.count > 0) {
-		if (!_OpDataArr_mpmemdup(&o->ev_op_data,
-					(SAU_ProgramOpData**) &o->ev->op_data,
-					o->mem)) goto MEM_ERR;
-		o->ev->op_data_count = o->ev_op_data.count;
-		o->ev_op_data.count = 0; // reuse allocation
-	}
-	for (size_t i = 0; i < o->ev->op_data_count; ++i) {
-		SAU_ProgramOpData *od = (SAU_ProgramOpData*) &o->ev->op_data[i];
-		SAU_OpAllocState *oas = &o->oa.a[od->id];
+	/*
+	 * Nodes left without changes, for operators which aren't new,
+	 * are removed, moving those after back.
+	 */
+	size_t od_start = o->od_prev.count, od_end = o->od_offs.count;
+	size_t i = od_start, offs = o->op_data.count;
+	if (od_start < od_end) offs = o->od_offs.a[od_start];
+	for (size_t j = od_start; j < od_end; ++j) {
+		SAU_ProgramOpData *od = (SAU_ProgramOpData*)
+			&o->op_data.a[o->od_offs.a[j]];
+		SAU_OpAllocState *oas = &o->oa.oas.a[od->id];
+		const SAU_ProgramOpList *old_lists[SAU_POP_USES - 1];
+		memcpy(old_lists, oas->mod_lists, sizeof(old_lists));
 		if (!ScriptConv_update_modlists(o, od)) goto MEM_ERR;
-		od->prev = oas->op_prev;
-		oas->op_prev = od;
+		if (!od->params && oas->od_prev > 0 &&
+		    !memcmp(old_lists, oas->mod_lists, sizeof(old_lists)))
+			continue;
+		size_t size = SAU_ProgramOpData_size(od->params);
+		if (offs != o->od_offs.a[j])
+			memmove(&o->op_data.a[offs], od, size);
+		o->od_offs.a[i] = offs;
+		offs += size;
+		if (!_SAU_IdArr_add(&o->od_prev, &oas->od_prev)) goto MEM_ERR;
+		oas->od_prev = ++i;
 	}
+	o->od_offs.count = i;
+	o->op_data.count = offs;
+	o->ev->op_data_count = i - od_start;
 	return true;
 MEM_ERR:
 	return false;
 }
 
+/*
+ * Set values in \p dst for its parameters, taking them from \p b if set
+ * there, otherwise from \p a, as if \p b were applied after \p a.
+ */
+static void merge_opvalues(SAU_ProgramOpData *restrict dst,
+		const SAU_ProgramOpData *restrict a,
+		const SAU_ProgramOpData *restrict b) {
+	const uint32_t ramps = SAU_POPP_FREQ | SAU_POPP_FREQ2 |
+		SAU_POPP_AMP | SAU_POPP_AMP2;
+	for (uint32_t param = 1; param <= SAU_POP_PARAMS; param <<= 1) {
+		if (!(dst->params & param)) continue;
+		size_t size = SAU_ProgramOpData_offs(param, param << 1);
+		uint8_t *v = SAU_ProgramOpData_VALUE(dst, param);
+		if (!(b->params & param)) {
+			memcpy(v, SAU_ProgramOpData_VALUE(a, param), size);
+		} else if ((a->params & param) != 0 && (param & ramps) != 0) {
+			SAU_Ramp ramp;
+			memcpy(&ramp, SAU_ProgramOpData_VALUE(a, param), size);
+			SAU_Ramp_copy(&ramp, (const SAU_Ramp*)
+					SAU_ProgramOpData_VALUE(b, param));
+			memcpy(v, &ramp, size);
+		} else {
+			memcpy(v, SAU_ProgramOpData_VALUE(b, param), size);
+		}
+	}
+}
+
+/*
+ * Check whether the event just converted, for script event \p e, can be
+ * merged into the previous, for the same voice at the same time.
+ *
+ * Not done if operators were freed for reuse with the previous event,
+ * nor if an operator has more than one node in the event.
+ */
+static bool ScriptConv_can_merge(ScriptConv *restrict o,
+		const SAU_ScriptEvData *restrict e, bool prev_freed_ops) {
+	const SAU_ProgramEvent *ev = o->ev;
+	if (e->wait_ms != 0 || !e->prev_vo_use || prev_freed_ops ||
+	    o->ev_list.count < 2 || ev[-1].vo_id != ev->vo_id ||
+	    (ev[-1].vo_data != NULL && ev->vo_data != NULL))
+		return false;
+	size_t end = o->od_offs.count, s2 = end - ev->op_data_count;
+	for (size_t j = s2; j < end; ++j)
+		if (o->od_prev.a[j] > s2) return false;
+	return true;
+}
+
+/*
+ * Merge the operator data nodes of the last two events, of which
+ * there are \p n1 and \p n2, into one list. Nodes for operators in
+ * both events are combined into one, the other nodes of the latter
+ * added after those of the former; as if applied in sequence.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ScriptConv_merge_opnodes(ScriptConv *restrict o,
+		size_t n1, size_t n2) {
+	size_t n = n1 + n2, s1 = o->od_offs.count - n;
+	size_t offs = o->od_offs.a[s1];
+	size_t tail = o->op_data.count - offs;
+	/*
+	 * Move the nodes aside, then add them back. For each node of the
+	 * former event, \a comb gets the index + 1 of the node to combine
+	 * it with, or 0 if none.
+	 */
+	if (!SAU_ByteArr_upsize(&o->merge_buf, tail) ||
+	    !_OffsArr_upsize(&o->merge_offs, n) ||
+	    !_SAU_IdArr_upsize(&o->merge_ids, n + n1))
+		return false;
+	memcpy(o->merge_buf.a, &o->op_data.a[offs], tail);
+	size_t *node_offs = o->merge_offs.a;
+	uint32_t *prevs = o->merge_ids.a, *comb = &o->merge_ids.a[n];
+	for (size_t k = 0; k < n; ++k) {
+		node_offs[k] = o->od_offs.a[s1 + k] - offs;
+		prevs[k] = o->od_prev.a[s1 + k];
+	}
+	for (size_t k = 0; k < n1; ++k)
+		comb[k] = 0;
+	for (size_t k = n1; k < n; ++k)
+		if (prevs[k] > s1) comb[prevs[k] - 1 - s1] = k + 1;
+	o->op_data.count = offs;
+	o->od_offs.count = s1;
+	o->od_prev.count = s1;
+	for (size_t k = 0; k < n; ++k) {
+		const SAU_ProgramOpData *a = (const SAU_ProgramOpData*)
+			&o->merge_buf.a[node_offs[k]], *b = NULL;
+		if (k >= n1 && prevs[k] > s1)
+			continue; /* combined with earlier node */
+		if (k < n1 && comb[k] > 0)
+			b = (const SAU_ProgramOpData*)
+				&o->merge_buf.a[node_offs[comb[k] - 1]];
+		uint32_t params = a->params | ((b != NULL) ? b->params : 0);
+		SAU_ProgramOpData *od = ScriptConv_add_opnode(o, params);
+		if (!od)
+			return false;
+		if (!b) {
+			memcpy(od, a, SAU_ProgramOpData_size(params));
+		} else {
+			*od = *b;
+			od->params = params;
+			if (!(b->params & SAU_POPP_TIME)) od->time = a->time;
+			merge_opvalues(od, a, b);
+		}
+		if (!_SAU_IdArr_add(&o->od_prev, &prevs[k]))
+			return false;
+		o->oa.oas.a[od->id].od_prev = o->od_offs.count;
+	}
+	return true;
+}
+
+/*
+ * Merge the event just converted into the previous, combining
+ * operator and voice data as if applied in sequence.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ScriptConv_merge_event(ScriptConv *restrict o) {
+	SAU_ProgramEvent *ev = o->ev, *prev_ev = ev - 1;
+	size_t n1 = prev_ev->op_data_count, n2 = ev->op_data_count;
+	if (n1 + n2 > 0) {
+		size_t s1 = o->od_offs.count - (n1 + n2);
+		if (!ScriptConv_merge_opnodes(o, n1, n2))
+			return false;
+		prev_ev->op_data_count = o->od_offs.count - s1;
+	}
+	if (ev->vo_data != NULL) {
+		const SAU_ProgramVoData *vd = ev->vo_data;
+		SAU_ProgramVoData *prev_vd = (SAU_ProgramVoData*)
+			prev_ev->vo_data;
+		if (!prev_vd) {
+			prev_ev->vo_data = vd;
+		} else {
+			if (vd->params & SAU_PVOP_PAN) {
+				if (prev_vd->params & SAU_PVOP_PAN)
+					SAU_Ramp_copy(&prev_vd->pan, &vd->pan);
+				else
+					prev_vd->pan = vd->pan;
+			}
+			prev_vd->params |= vd->params;
+			prev_vd->carriers = vd->carriers;
+			o->va.vas.a[ev->vo_id].vo_prev = prev_vd;
+		}
+	}
+	--o->ev_list.count;
+	o->ev = prev_ev;
+	++o->ev_merged;
+	return true;
+}
+
 /*
  * Convert all voice and operator data for a script event node into a
  * series of output events.
@@ -321,11 +714,12 @@ static bool ScriptConv_convert_event(ScriptConv *restrict o,
 		SAU_ScriptEvData *restrict e) {
 	uint32_t vo_id;
 	uint32_t vo_params;
+	bool prev_freed_ops = o->ev_freed_ops;
+	o->ev_freed_ops = false;
 	if (!SAU_VoAlloc_update(&o->va, e, &vo_id)) goto MEM_ERR;
-	SAU_VoAllocState *vas = &o->va.a[vo_id];
-	SAU_ProgramEvent *out_ev = SAU_MemPool_alloc(o->mem,
-			sizeof(SAU_ProgramEvent));
-	if (!out_ev || !SAU_PtrArr_add(&o->ev_list, out_ev)) goto MEM_ERR;
+	SAU_VoAllocState *vas = &o->va.vas.a[vo_id];
+	SAU_ProgramEvent *out_ev = _ProgramEventArr_add(&o->ev_list, NULL);
+	if (!out_ev) goto MEM_ERR;
 	out_ev->wait_ms = e->wait_ms;
 	out_ev->vo_id = vo_id;
 	o->ev = out_ev;
@@ -342,19 +736,254 @@ static bool ScriptConv_convert_event(ScriptConv *restrict o,
 		ovd->params = vo_params;
 		ovd->pan = e->pan;
 		if (e->carriers != NULL) {
-			if (!update_oplist(&vas->carriers, e->carriers,
-						o->mem)) goto MEM_ERR;
+			if (!ScriptConv_update_oplist(o, &vas->carriers,
+						e->carriers)) goto MEM_ERR;
 		}
 		ovd->carriers = vas->carriers;
 		ovd->prev = vas->vo_prev;
 		out_ev->vo_data = ovd;
 		vas->vo_prev = ovd;
+		if ((vo_params & SAU_PVOP_GRAPH) && vas->carriers->count > 0) {
+			size_t free_count = o->oa.free.count;
+			if (!SAU_OpAlloc_collect(&o->oa, vas)) goto MEM_ERR;
+			if (o->oa.free.count > free_count)
+				o->ev_freed_ops = true;
+		}
+	}
+	if (ScriptConv_can_merge(o, e, prev_freed_ops)) {
+		if (!ScriptConv_merge_event(o)) goto MEM_ERR;
+		o->ev_freed_ops |= prev_freed_ops;
 	}
 	return true;
 MEM_ERR:
 	return false;
 }
 
+/*
+ * Operator lifetime flags, used for pruning. A lifetime
+ * begins with the node for a new operator.
+ */
+enum {
+	OPL_AMP   = 1<<0, // amplitude may be non-zero
+	OPL_AMP2  = 1<<1, // amplitude modulation range may be non-zero
+	OPL_AMODS = 1<<2, // amplitude modulators linked
+	OPL_MUTE  = 1<<3, // output zero; subnodes needn't run
+	OPL_USED  = 1<<4, // reached in a voice graph
+	OPL_LIVE  = 1<<5, // reached, and not only through muted nodes
+};
+
+sauArrType(OpLifeArr, uint8_t, _)
+
+/*
+ * State for finding operators which are never used, or whose
+ * output is zero throughout their lifetimes.
+ */
+typedef struct OpPrune {
+	OpLifeArr lives;
+	SAU_IdArr node_life; // lifetime index for each node
+	SAU_IdArr cur_node; // latest node index for each operator ID
+	SAU_IdArr mute_path; // lifetimes of muted nodes being traversed
+	SAU_ByteArr on_path; // for each operator ID, to skip cycles
+	bool check, changed;
+} OpPrune;
+
+static inline SAU_ProgramOpData *ScriptConv_get_opnode(ScriptConv *restrict o,
+		size_t i) {
+	return (SAU_ProgramOpData*) &o->op_data.a[o->od_offs.a[i]];
+}
+
+static bool ramp_nonzero(const SAU_Ramp *restrict ramp) {
+	return ((ramp->flags & SAU_RAMPP_STATE) != 0 && ramp->v0 != 0.f) ||
+		((ramp->flags & SAU_RAMPP_GOAL) != 0 && ramp->vt != 0.f);
+}
+
+static bool ScriptConv_prune_list(ScriptConv *restrict o,
+		OpPrune *restrict p, const SAU_ProgramOpList *restrict list);
+
+/*
+ * Visit operator node in voice graph, as done when running it.
+ *
+ * When not checking, marks the lifetime used, and live unless reached
+ * through a muted node. When checking, muted nodes which the node is
+ * reached through are unmuted if it's live, as skipping their subnodes
+ * would then skip running it.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ScriptConv_prune_visit(ScriptConv *restrict o,
+		OpPrune *restrict p, uint32_t op_id) {
+	if (p->on_path.a[op_id])
+		return true;
+	uint32_t node = p->cur_node.a[op_id];
+	uint32_t life = p->node_life.a[node];
+	uint8_t *flags = &p->lives.a[life];
+	bool muted_path = (p->mute_path.count > 0);
+	if (!p->check) {
+		*flags |= OPL_USED;
+		if (!muted_path) *flags |= OPL_LIVE;
+	} else if (muted_path && (*flags & OPL_LIVE) != 0) {
+		for (size_t i = 0; i < p->mute_path.count; ++i) {
+			uint8_t *mute_flags = &p->lives.a[p->mute_path.a[i]];
+			if (!(*mute_flags & OPL_MUTE)) continue;
+			*mute_flags &= ~OPL_MUTE;
+			p->changed = true;
+		}
+	}
+	bool mute = (*flags & OPL_MUTE) != 0;
+	if (mute && !_SAU_IdArr_add(&p->mute_path, &life))
+		return false;
+	const SAU_ProgramOpData *od = ScriptConv_get_opnode(o, node);
+	p->on_path.a[op_id] = 1;
+	if (!ScriptConv_prune_list(o, p, od->fmods) ||
+	    !ScriptConv_prune_list(o, p, od->pmods) ||
+	    !ScriptConv_prune_list(o, p, od->amods))
+		return false;
+	p->on_path.a[op_id] = 0;
+	if (mute) --p->mute_path.count;
+	return true;
+}
+
+static bool ScriptConv_prune_list(ScriptConv *restrict o,
+		OpPrune *restrict p, const SAU_ProgramOpList *restrict list) {
+	for (uint32_t i = 0; i < list->count; ++i)
+		if (!ScriptConv_prune_visit(o, p, list->ids[i]))
+			return false;
+	return true;
+}
+
+/*
+ * Traverse the voice graphs in order of events, as each is set,
+ * with the operator nodes current at each point.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ScriptConv_prune_traverse(ScriptConv *restrict o,
+		OpPrune *restrict p) {
+	for (size_t i = 0, od_i = 0; i < o->ev_list.count; ++i) {
+		const SAU_ProgramEvent *ev = &o->ev_list.a[i];
+		for (size_t j = 0; j < ev->op_data_count; ++j, ++od_i)
+			p->cur_node.a[ScriptConv_get_opnode(o, od_i)->id] =
+				od_i;
+		const SAU_ProgramVoData *vd = ev->vo_data;
+		if (!vd || !(vd->params & SAU_PVOP_GRAPH))
+			continue;
+		if (!ScriptConv_prune_list(o, p, vd->carriers))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Remove the nodes of operators never reached in a voice graph,
+ * and mark those whose output is zero throughout their lifetime,
+ * so that running them and their subnodes can be skipped.
+ *
+ * Amplitude is zero throughout if never set to anything else,
+ * including by ramping, and amplitude modulation doesn't change it.
+ * Subnodes are only skipped if not otherwise run in their lifetime;
+ * this is repeated until no further muted nodes are unmuted.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ScriptConv_prune(ScriptConv *restrict o) {
+	OpPrune p = (OpPrune){0};
+	size_t od_count = o->od_offs.count;
+	size_t op_count = o->oa.oas.count;
+	bool ok = false;
+	if (!_SAU_IdArr_upsize(&p.node_life, od_count) ||
+	    !_SAU_IdArr_upsize(&p.cur_node, op_count) ||
+	    !SAU_ByteArr_upsize(&p.on_path, op_count))
+		goto DONE;
+	if (op_count > 0)
+		memset(p.on_path.a, 0, op_count);
+	for (size_t i = 0; i < od_count; ++i) {
+		const SAU_ProgramOpData *od = ScriptConv_get_opnode(o, i);
+		uint32_t prev = o->od_prev.a[i], life;
+		if (prev > 0) {
+			life = p.node_life.a[prev - 1];
+		} else {
+			life = p.lives.count;
+			if (!_OpLifeArr_add(&p.lives, NULL))
+				goto DONE;
+		}
+		p.node_life.a[i] = life;
+		uint8_t *flags = &p.lives.a[life];
+		const uint8_t *v;
+		if (od->params & SAU_POPP_AMP) {
+			v = SAU_ProgramOpData_VALUE(od, SAU_POPP_AMP);
+			if (ramp_nonzero((const SAU_Ramp*) v))
+				*flags |= OPL_AMP;
+		}
+		if (od->params & SAU_POPP_AMP2) {
+			v = SAU_ProgramOpData_VALUE(od, SAU_POPP_AMP2);
+			if (ramp_nonzero((const SAU_Ramp*) v))
+				*flags |= OPL_AMP2;
+		}
+		if (od->amods->count > 0)
+			*flags |= OPL_AMODS;
+	}
+	for (size_t i = 0; i < p.lives.count; ++i) {
+		uint8_t *flags = &p.lives.a[i];
+		if (!(*flags & OPL_AMP) &&
+		    (!(*flags & OPL_AMODS) || !(*flags & OPL_AMP2)))
+			*flags |= OPL_MUTE;
+	}
+	do {
+		for (size_t i = 0; i < p.lives.count; ++i)
+			p.lives.a[i] &= ~(OPL_USED | OPL_LIVE);
+		p.check = false;
+		if (!ScriptConv_prune_traverse(o, &p)) goto DONE;
+		p.check = true;
+		p.changed = false;
+		if (!ScriptConv_prune_traverse(o, &p)) goto DONE;
+	} while (p.changed);
+	/*
+	 * Remove unused nodes, moving the rest back, and mark muted.
+	 * Nodes only refer back to nodes in the same lifetime, so the
+	 * lifetime array can be reused to map the indices of those kept.
+	 */
+	size_t kept = 0, offs = 0;
+	for (size_t i = 0, od_i = 0; i < o->ev_list.count; ++i) {
+		SAU_ProgramEvent *ev = &o->ev_list.a[i];
+		size_t ev_kept = 0;
+		for (size_t j = 0; j < ev->op_data_count; ++j, ++od_i) {
+			SAU_ProgramOpData *od = ScriptConv_get_opnode(o, od_i);
+			uint32_t prev = o->od_prev.a[od_i];
+			uint8_t flags = p.lives.a[p.node_life.a[od_i]];
+			if (!(flags & OPL_USED)) {
+				if (!prev) ++o->ops_unused;
+				continue;
+			}
+			if (!prev && (flags & OPL_MUTE) != 0) {
+				od->params |= SAU_POPF_MUTE;
+				++o->ops_muted;
+			}
+			size_t size = SAU_ProgramOpData_size(od->params);
+			if (offs != o->od_offs.a[od_i])
+				memmove(&o->op_data.a[offs], od, size);
+			o->od_offs.a[kept] = offs;
+			o->od_prev.a[kept] = (prev > 0) ?
+				p.node_life.a[prev - 1] + 1 : 0;
+			p.node_life.a[od_i] = kept; /* now maps index */
+			offs += size;
+			++kept;
+			++ev_kept;
+		}
+		ev->op_data_count = ev_kept;
+	}
+	o->op_data.count = offs;
+	o->od_offs.count = kept;
+	o->od_prev.count = kept;
+	ok = true;
+DONE:
+	_OpLifeArr_clear(&p.lives);
+	_SAU_IdArr_clear(&p.node_life);
+	_SAU_IdArr_clear(&p.cur_node);
+	_SAU_IdArr_clear(&p.mute_path);
+	SAU_ByteArr_clear(&p.on_path);
+	return ok;
+}
+
 /*
  * Check whether program can be returned for use.
  *
@@ -363,13 +992,13 @@ MEM_ERR:
 static bool ScriptConv_check_validity(ScriptConv *restrict o,
 		SAU_Script *restrict script) {
 	bool error = false;
-	if (o->va.count > SAU_PVO_MAX_ID) {
+	if (o->va.vas.count > SAU_PVO_MAX_ID) {
 		fprintf(stderr,
 "%s: error: number of voices used cannot exceed %d\n",
 			script->name, SAU_PVO_MAX_ID);
 		error = true;
 	}
-	if (o->oa.count > SAU_POP_MAX_ID) {
+	if (o->oa.oas.count > SAU_POP_MAX_ID) {
 		fprintf(stderr,
 "%s: error: number of operators used cannot exceed %d\n",
 			script->name, SAU_POP_MAX_ID);
@@ -382,8 +1011,26 @@ static SAU_Program *ScriptConv_create_program(ScriptConv *restrict o,
 		SAU_Script *restrict script) {
 	SAU_Program *prg = SAU_MemPool_alloc(o->mem, sizeof(SAU_Program));
 	if (!prg) goto MEM_ERR;
-	if (!SAU_PtrArr_mpmemdup(&o->ev_list,
-				(void***) &prg->events, o->mem)) goto MEM_ERR;
+	SAU_ProgramEvent *events;
+	uint8_t *op_data;
+	if (!_ProgramEventArr_mpmemdup(&o->ev_list, &events, o->mem) ||
+	    !SAU_ByteArr_mpmemdup(&o->op_data, &op_data, o->mem))
+		goto MEM_ERR;
+	for (size_t i = 0; i < o->od_offs.count; ++i) {
+		SAU_ProgramOpData *od = (SAU_ProgramOpData*)
+			&op_data[o->od_offs.a[i]];
+		uint32_t prev = o->od_prev.a[i];
+		od->prev = (prev > 0) ? (SAU_ProgramOpData*)
+			&op_data[o->od_offs.a[prev - 1]] : NULL;
+	}
+	for (size_t i = 0, od_i = 0; i < o->ev_list.count; ++i) {
+		SAU_ProgramEvent *ev = &events[i];
+		if (ev->op_data_count > 0)
+			ev->op_data = (SAU_ProgramOpData*)
+				&op_data[o->od_offs.a[od_i]];
+		od_i += ev->op_data_count;
+	}
+	prg->events = events;
 	prg->ev_count = o->ev_list.count;
 	if (!(script->sopt.changed & SAU_SOPT_AMPMULT)) {
 		/*
@@ -392,10 +1039,21 @@ static SAU_Program *ScriptConv_create_program(ScriptConv *restrict o,
 		 */
 		prg->mode |= SAU_PMODE_AMP_DIV_VOICES;
 	}
-	prg->vo_count = o->va.count;
-	prg->op_count = o->oa.count;
+	prg->vo_count = o->va.vas.count;
+	prg->op_count = o->oa.oas.count;
+	prg->op_list_count = o->list_count;
+	prg->op_list_uses = o->list_uses;
+	prg->ev_merged = o->ev_merged;
+	prg->params_pruned = o->params_pruned;
+	prg->ops_unused = o->ops_unused;
+	prg->ops_muted = o->ops_muted;
 	prg->duration_ms = o->duration_ms;
 	prg->name = script->name;
+	if (script->msgs != NULL) {
+		prg->msgs = SAU_MemPool_memdup(o->mem, script->msgs,
+				strlen(script->msgs) + 1);
+		if (!prg->msgs) goto MEM_ERR;
+	}
 	prg->mem = o->mem;
 	o->mem = NULL; // pass on to program
 	return prg;
@@ -409,20 +1067,23 @@ MEM_ERR:
 static SAU_Program *ScriptConv_convert(ScriptConv *restrict o,
 		SAU_Script *restrict script) {
 	SAU_Program *prg = NULL;
-	o->mem = SAU_create_MemPool(0);
+	o->mem = SAU_obtain_MemPool(0);
 	if (!o->mem) goto MEM_ERR;
+	o->lists = SAU_create_SymTab(o->mem);
+	if (!o->lists) goto MEM_ERR;
 
 	uint32_t remaining_ms = 0;
 	for (SAU_ScriptEvData *e = script->events; e; e = e->next) {
 		if (!ScriptConv_convert_event(o, e)) goto MEM_ERR;
 		o->duration_ms += e->wait_ms;
 	}
-	for (size_t i = 0; i < o->va.count; ++i) {
-		SAU_VoAllocState *vas = &o->va.a[i];
-		if (vas->duration_ms > remaining_ms)
-			remaining_ms = vas->duration_ms;
+	for (size_t i = 0; i < o->va.vas.count; ++i) {
+		SAU_VoAllocState *vas = &o->va.vas.a[i];
+		if (vas->end_ms > o->duration_ms + remaining_ms)
+			remaining_ms = vas->end_ms - o->duration_ms;
 	}
 	o->duration_ms += remaining_ms;
+	if (!ScriptConv_prune(o)) goto MEM_ERR;
 	if (ScriptConv_check_validity(o, script)) {
 		prg = ScriptConv_create_program(o, script);
 		if (!prg) goto MEM_ERR;
@@ -433,9 +1094,16 @@ static SAU_Program *ScriptConv_convert(ScriptConv *restrict o,
 	}
 	SAU_OpAlloc_clear(&o->oa);
 	SAU_VoAlloc_clear(&o->va);
-	_OpDataArr_clear(&o->ev_op_data);
-	SAU_PtrArr_clear(&o->ev_list);
-	SAU_destroy_MemPool(o->mem);
+	SAU_ByteArr_clear(&o->op_data);
+	_OffsArr_clear(&o->od_offs);
+	_SAU_IdArr_clear(&o->od_prev);
+	_SAU_IdArr_clear(&o->list_buf);
+	SAU_ByteArr_clear(&o->merge_buf);
+	_OffsArr_clear(&o->merge_offs);
+	_SAU_IdArr_clear(&o->merge_ids);
+	SAU_destroy_SymTab(o->lists);
+	_ProgramEventArr_clear(&o->ev_list);
+	SAU_release_MemPool(o->mem);
 	return prg;
 }
 
@@ -456,7 +1124,7 @@ SAU_Program* SAU_build_Program(SAU_Script *restrict sd) {
 void SAU_discard_Program(SAU_Program *restrict o) {
 	if (!o)
 		return;
-	SAU_destroy_MemPool(o->mem);
+	SAU_release_MemPool(o->mem);
 }
 
 static sauNoinline void print_linked(const char *restrict header,
@@ -471,6 +1139,13 @@ static sauNoinline void print_linked(const char *restrict header,
 }
 
 static void print_opline(const SAU_ProgramOpData *restrict od) {
+	static const SAU_Ramp unset = {0};
+	const SAU_Ramp *freq = (od->params & SAU_POPP_FREQ) ?
+		(const SAU_Ramp*) SAU_ProgramOpData_VALUE(od, SAU_POPP_FREQ) :
+		&unset;
+	const SAU_Ramp *amp = (od->params & SAU_POPP_AMP) ?
+		(const SAU_Ramp*) SAU_ProgramOpData_VALUE(od, SAU_POPP_AMP) :
+		&unset;
 	if (od->time.flags & SAU_TIMEP_LINKED) {
 		fprintf(stdout,
 			"\n\top %d \tt=INF   \t", od->id);
@@ -478,31 +1153,31 @@ static void print_opline(const SAU_ProgramOpData *restrict od) {
 		fprintf(stdout,
 			"\n\top %d \tt=%-6d\t", od->id, od->time.v_ms);
 	}
-	if ((od->freq.flags & SAU_RAMPP_STATE) != 0) {
-		if ((od->freq.flags & SAU_RAMPP_GOAL) != 0)
+	if ((freq->flags & SAU_RAMPP_STATE) != 0) {
+		if ((freq->flags & SAU_RAMPP_GOAL) != 0)
 			fprintf(stdout,
-				"f=%-6.1f->%-6.1f", od->freq.v0, od->freq.vt);
+				"f=%-6.1f->%-6.1f", freq->v0, freq->vt);
 		else
 			fprintf(stdout,
-				"f=%-6.1f\t", od->freq.v0);
+				"f=%-6.1f\t", freq->v0);
 	} else {
-		if ((od->freq.flags & SAU_RAMPP_GOAL) != 0)
+		if ((freq->flags & SAU_RAMPP_GOAL) != 0)
 			fprintf(stdout,
-				"f->%-6.1f\t", od->freq.vt);
+				"f->%-6.1f\t", freq->vt);
 		else
 			fprintf(stdout,
 				"\t\t");
 	}
-	if ((od->amp.flags & SAU_RAMPP_STATE) != 0) {
-		if ((od->amp.flags & SAU_RAMPP_GOAL) != 0)
+	if ((amp->flags & SAU_RAMPP_STATE) != 0) {
+		if ((amp->flags & SAU_RAMPP_GOAL) != 0)
 			fprintf(stdout,
-				"\ta=%-6.1f->%-6.1f", od->amp.v0, od->amp.vt);
+				"\ta=%-6.1f->%-6.1f", amp->v0, amp->vt);
 		else
 			fprintf(stdout,
-				"\ta=%-6.1f", od->amp.v0);
-	} else if ((od->amp.flags & SAU_RAMPP_GOAL) != 0) {
+				"\ta=%-6.1f", amp->v0);
+	} else if ((amp->flags & SAU_RAMPP_GOAL) != 0) {
 		fprintf(stdout,
-			"\ta->%-6.1f", od->amp.vt);
+			"\ta->%-6.1f", amp->vt);
 	}
 }
 
@@ -520,11 +1195,23 @@ void SAU_Program_print_info(const SAU_Program *restrict o,
 		"\tDuration: \t%d ms\n"
 		"\tEvents:   \t%zd\n"
 		"\tVoices:   \t%hd\n"
-		"\tOperators:\t%d\n",
+		"\tOperators:\t%d\n"
+		"\tOp lists: \t%d unique of %d (%.1f:1)\n",
 		o->duration_ms,
 		o->ev_count,
 		o->vo_count,
-		o->op_count);
+		o->op_count,
+		o->op_list_count, o->op_list_uses,
+		(double) o->op_list_uses /
+		((o->op_list_count > 0) ? o->op_list_count : 1));
+	if (o->ev_merged > 0 || o->params_pruned > 0)
+		fprintf(stdout,
+			"\tRemoved:  \t%d events merged, %d no-op updates\n",
+			o->ev_merged, o->params_pruned);
+	if (o->ops_unused > 0 || o->ops_muted > 0)
+		fprintf(stdout,
+			"\tPruned:   \t%d unused operators, %d muted\n",
+			o->ops_unused, o->ops_muted);
 }
 
 /**
@@ -542,8 +1229,9 @@ void SAU_ProgramEvent_print_voice(const SAU_ProgramEvent *restrict ev) {
  * Print event data operator information.
  */
 void SAU_ProgramEvent_print_operators(const SAU_ProgramEvent *restrict ev) {
-	for (size_t i = 0; i < ev->op_data_count; ++i) {
-		const SAU_ProgramOpData *od = &ev->op_data[i];
+	const SAU_ProgramOpData *od = ev->op_data;
+	for (size_t i = 0; i < ev->op_data_count;
+			++i, od = SAU_ProgramOpData_next(od)) {
 		const SAU_ProgramOpData *od_prev = od->prev;
 		print_opline(od);
 		if (!od_prev || od->fmods != od_prev->fmods)
@@ -17,6 +17,19 @@
 #include "../arrtype.h"
 #include "../mempool.h"
 
+/**
+ * Min-heap item for ID allocation, ordered by key, then ID.
+ */
+typedef struct SAU_IdHeapItem {
+	uint32_t key;
+	uint32_t id;
+} SAU_IdHeapItem;
+
+sauArrType(SAU_IdHeap, SAU_IdHeapItem, _)
+
+/** ID (uint32_t) array type. */
+sauArrType(SAU_IdArr, uint32_t, _)
+
 /**
  * Voice allocation state flags.
  */
@@ -26,33 +39,60 @@ enum {
 
 /**
  * Per-voice state used during program data allocation.
+ *
+ * The operators created for a voice ID are listed in \a op_ids,
+ * kept when the voice ID is reused.
  */
 typedef struct SAU_VoAllocState {
 	SAU_ScriptEvData *last_sev;
 	const SAU_ProgramOpList *carriers;
 	SAU_ProgramVoData *vo_prev;
 	uint32_t flags;
-	uint32_t duration_ms;
+	uint32_t end_ms;
+	SAU_IdArr op_ids;
 } SAU_VoAllocState;
 
-sauArrType(SAU_VoAlloc, SAU_VoAllocState, _)
+sauArrType(SAU_VoAllocStateArr, SAU_VoAllocState, _)
 
 /**
- * Operator allocation state flags.
+ * Voice allocator. Voices which are no longer used after their last
+ * event wait in \a expiring, keyed by end time, until moved to \a free
+ * for reuse, lowest ID first.
  */
-//enum {
-//	SAU_OAS_VISITED = 1<<0,
-//};
+typedef struct SAU_VoAlloc {
+	SAU_VoAllocStateArr vas;
+	SAU_IdHeap expiring;
+	SAU_IdHeap free;
+	uint32_t time_ms;
+} SAU_VoAlloc;
 
 /**
  * Per-operator state used during program data allocation.
+ *
+ * Parameter values known to be current, as set without a goal ever
+ * having been set, are tracked using \a known, for removing updates
+ * which change nothing. \a goals holds the ramp parameters given goals.
  */
 typedef struct SAU_OpAllocState {
 	SAU_ScriptOpData *last_sod;
 	const SAU_ProgramOpList *mod_lists[SAU_POP_USES - 1];
-	SAU_ProgramOpData *op_prev;
-	uint32_t flags;
-	//uint32_t duration_ms;
+	uint32_t od_prev; // index + 1 of latest data, or 0 if none
+	uint32_t mark;
+	uint32_t known, goals;
+	uint8_t wave;
+	SAU_Ramp freq, freq2;
+	SAU_Ramp amp, amp2;
 } SAU_OpAllocState;
 
-sauArrType(SAU_OpAlloc, SAU_OpAllocState, _)
+sauArrType(SAU_OpAllocStateArr, SAU_OpAllocState, _)
+
+/**
+ * Operator allocator. Operators which are no longer reachable from
+ * their voice's graph, nor used later, are moved to \a free for reuse,
+ * lowest ID first. \a mark is the latest reachability pass number.
+ */
+typedef struct SAU_OpAlloc {
+	SAU_OpAllocStateArr oas;
+	SAU_IdHeap free;
+	uint32_t mark;
+} SAU_OpAlloc;
@@ -14,11 +14,13 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include "common.h"
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /*
  * Print to stderr. message, optionally including a descriptive label.
@@ -78,6 +80,57 @@ void *SAU_memdup(const void *restrict src, size_t size) {
 	return dst;
 }
 
+/*
+ * Handle "--name" or "--name=arg" long option for SAU_getopt().
+ */
+static int get_longopt(char *const*restrict argv,
+		const char *restrict optstring, struct SAU_opt *restrict opt) {
+	const char *arg = &argv[opt->ind][2];
+	const char *eq = strchr(arg, '=');
+	size_t len = (eq != NULL) ? (size_t) (eq - arg) : strlen(arg);
+	const struct SAU_longopt *lo;
+	bool err = (opt->err != 0 && *optstring != ':');
+	for (lo = opt->longopts; lo->name != NULL; ++lo) {
+		if (!strncmp(lo->name, arg, len) && lo->name[len] == '\0')
+			break;
+	}
+	if (!lo->name) {
+		if (err)
+			fprintf(stderr, "%s: invalid option '--%.*s'\n",
+					argv[0], (int) len, arg);
+		return '?';
+	}
+	opt->opt = lo->val;
+	opt->pos = 1;
+	if (lo->has_arg) {
+		if (eq != NULL) {
+			opt->arg = eq + 1;
+			++opt->ind;
+			return opt->opt;
+		}
+		if (argv[opt->ind + 1] != NULL) {
+			opt->arg = argv[opt->ind + 1];
+			opt->ind += 2;
+			return opt->opt;
+		}
+		if (err)
+			fprintf(stderr,
+"%s: option '--%s' requires an argument\n",
+					argv[0], lo->name);
+		return (*optstring == ':') ? ':' : '?';
+	}
+	if (eq != NULL) {
+		if (err)
+			fprintf(stderr,
+"%s: option '--%s' doesn't take an argument\n",
+					argv[0], lo->name);
+		return '?';
+	}
+	++opt->ind;
+	opt->arg = argv[opt->ind];
+	return opt->opt;
+}
+
 /**
  * Command-line argument parser similar to POSIX getopt(),
  * but replacing opt* global variables with \p opt fields.
@@ -85,6 +138,9 @@ void *SAU_memdup(const void *restrict src, size_t size) {
  * The \a arg field is always set for each valid option, so as to be
  * available for reading as an unspecified optional option argument.
  *
+ * Long options, "--name" or "--name=arg", are also handled
+ * if listed in the \a longopts field.
+ *
  * In large part based on the public domain
  * getopt() version by Christopher Wellons.
  */
@@ -102,6 +158,8 @@ int SAU_getopt(int argc, char *const*restrict argv,
 		++opt->ind;
 		return -1;
 	}
+	if (arg[1] == '-' && opt->longopts != NULL)
+		return get_longopt(argv, optstring, opt);
 	opt->opt = arg[opt->pos];
 	const char *subs = strchr(optstring, opt->opt);
 	if (opt->opt == ':' || !subs) {
@@ -138,3 +196,14 @@ int SAU_getopt(int argc, char *const*restrict argv,
 	}
 	return opt->opt;
 }
+
+/**
+ * Get time for measuring intervals, from a monotonic clock.
+ *
+ * \return nanoseconds since an arbitrary point
+ */
+uint64_t SAU_time_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * (uint64_t) 1000000000 + ts.tv_nsec;
+}
@@ -34,11 +34,20 @@
 # define sauNoinline __attribute__((noinline))
 # define sauPrintflike(string_index, first_to_check) \
 	__attribute__((format(printf, string_index, first_to_check)))
+# define sauThreadLocal __thread
+# define SAU_HAVE_THREAD_LOCAL 1
 #else
 # define sauMalloclike
 # define sauMaybeUnused
 # define sauNoinline
 # define sauPrintflike(string_index, first_to_check)
+# if __STDC_VERSION__ >= 201112L
+#  define sauThreadLocal _Thread_local
+#  define SAU_HAVE_THREAD_LOCAL 1
+# else
+#  define sauThreadLocal /* shared by threads; check the below */
+#  define SAU_HAVE_THREAD_LOCAL 0
+# endif
 #endif
 
 /*
@@ -65,13 +74,24 @@ void SAU_error(const char *restrict label, const char *restrict fmt, ...)
 
 void *SAU_memdup(const void *restrict src, size_t size) sauMalloclike;
 
-/** SAU_getopt() data. Initialize to zero, except \a err for error messages. */
+uint64_t SAU_time_ns(void);
+
+/** Long option for SAU_getopt(), for which \a val is returned. */
+struct SAU_longopt {
+	const char *name;
+	int val;
+	bool has_arg;
+};
+
+/** SAU_getopt() data. Initialize to zero, except \a err for error messages,
+    and optionally \a longopts for a list ending with a NULL name. */
 struct SAU_opt {
 	int ind; /* set to zero to start over next SAU_getopt() call */
 	int err;
 	int pos;
 	int opt;
 	const char *arg;
+	const struct SAU_longopt *longopts;
 };
 int SAU_getopt(int argc, char *const*restrict argv,
 		const char *restrict optstring, struct SAU_opt *restrict opt);
@@ -83,9 +103,6 @@ int SAU_getopt(int argc, char *const*restrict argv,
 /* Debug-friendly memory handling? (Slower.) */
 //#define SAU_MEM_DEBUG 1
 
-/* Print symbol table statistics for testing? */
-//#define SAU_SYMTAB_STATS 0
-
 /* Make test lexer quiet enough to time it. */
 #define SAU_LEXER_QUIET 1
 
@@ -0,0 +1,647 @@
+/* saugns: Audio program render cost estimator.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "cost.h"
+#include "interp.h"
+#include "prealloc.h"
+#include "mixer.h"
+#include "../saugns.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+/*
+ * The walk mirrors the interpreter's handling of events and running
+ * of voice graphs, keeping only operator time, silence, and links.
+ * It goes from event to event instead of block by block, which gives
+ * the same lengths, as operator times are only reduced by lengths run.
+ */
+
+typedef struct CostWalk {
+	SAU_Cost *cost;
+	SAU_PreAlloc pa;
+	uint8_t *waves;
+	uint64_t pos;
+} CostWalk;
+
+static uint32_t walk_op(CostWalk *restrict o, uint32_t op_id,
+		uint32_t len, uint32_t depth, bool wave_env);
+
+static void walk_op_list(CostWalk *restrict o,
+		const SAU_ProgramOpList *restrict list,
+		uint32_t len, uint32_t depth, bool wave_env) {
+	for (uint32_t i = 0; i < list->count; ++i)
+		walk_op(o, list->ids[i], len, depth, wave_env);
+}
+
+/*
+ * Count use of operator for \p len samples, and of its subnodes.
+ *
+ * \return number of samples, including leading silence
+ */
+static uint32_t walk_op(CostWalk *restrict o, uint32_t op_id,
+		uint32_t len, uint32_t depth, bool wave_env) {
+	OperatorNode *n = &o->pa.operators[op_id];
+	SAU_Cost *cost = o->cost;
+	uint32_t zero_len = 0;
+	if (n->silence) {
+		zero_len = n->silence;
+		if (zero_len > len)
+			zero_len = len;
+		len -= zero_len;
+		if (!(n->flags & ON_TIME_INF)) n->time -= zero_len;
+		n->silence -= zero_len;
+		if (!len)
+			return zero_len;
+	}
+	if ((n->flags & ON_VISITED) != 0)
+		return zero_len + len;
+	if (n->time < len && !(n->flags & ON_TIME_INF))
+		len = n->time;
+	if (depth > cost->max_depth)
+		cost->max_depth = depth;
+	if ((n->flags & ON_MUTE) != 0) {
+		cost->muted_samples += len;
+	} else {
+		n->flags |= ON_VISITED;
+		cost->op_samples[o->waves[op_id]] += len;
+		if (depth > 0) cost->mod_samples += len;
+		if (n->pmods->count > 0) cost->pm_samples += len;
+		if (wave_env) cost->env_samples += len;
+		/*
+		 * Frequency and amplitude, each with a second value
+		 * filled and mixed if modulated.
+		 */
+		cost->ramp_samples += (uint64_t) len *
+			(2 + 2*(n->fmods->count > 0) + 2*(n->amods->count > 0));
+		walk_op_list(o, n->fmods, len, depth + 1, true);
+		walk_op_list(o, n->pmods, len, depth + 1, false);
+		walk_op_list(o, n->amods, len, depth + 1, true);
+		n->flags &= ~ON_VISITED;
+	}
+	if (!(n->flags & ON_TIME_INF))
+		n->time -= len;
+	return zero_len + len;
+}
+
+/*
+ * Count use of all active voices for \p len samples.
+ */
+static void walk_voices(CostWalk *restrict o, uint32_t len) {
+	SAU_Cost *cost = o->cost;
+	uint32_t active = 0;
+	for (uint32_t i = 0; i < o->pa.vo_count; ++i) {
+		VoiceNode *vn = &o->pa.voices[i];
+		if (vn->graph != NULL && vn->duration > 0) ++active;
+	}
+	if (active > cost->peak_voices) {
+		cost->peak_voices = active;
+		cost->peak_ms = (o->pos * 1000) / cost->srate;
+	}
+	for (uint32_t i = 0; i < o->pa.vo_count; ++i) {
+		VoiceNode *vn = &o->pa.voices[i];
+		if (!vn->graph || !vn->duration) continue;
+		uint32_t time = (vn->duration < len) ? vn->duration : len;
+		uint32_t out_len = 0;
+		for (uint32_t j = 0; j < vn->graph_count; ++j) {
+			const SAU_ProgramOpRef *or = &vn->graph[j];
+			if (or->use != SAU_POP_CARR) continue;
+			if (!o->pa.operators[or->id].time) continue;
+			uint32_t last_len = walk_op(o, or->id, time, 0, false);
+			if (last_len > out_len) out_len = last_len;
+		}
+		cost->mix_samples += out_len;
+		vn->duration -= time;
+	}
+	o->pos += len;
+}
+
+/*
+ * Apply the updates of an event which count for the walk.
+ */
+static void handle_event(CostWalk *restrict o,
+		const EventNode *restrict e) {
+	const SAU_ProgramEvent *prg_e = e->prg_e;
+	const SAU_ProgramOpData *od = prg_e->op_data;
+	uint32_t srate = o->pa.srate;
+	for (size_t i = 0; i < prg_e->op_data_count;
+			++i, od = SAU_ProgramOpData_next(od)) {
+		OperatorNode *on = &o->pa.operators[od->id];
+		uint32_t params = od->params;
+		if (!od->prev) {
+			on->time = 0;
+			on->silence = 0;
+			on->flags = (params & SAU_POPF_MUTE) ? ON_MUTE : 0;
+			o->waves[od->id] = SAU_WAVE_SIN;
+		}
+		on->fmods = od->fmods;
+		on->pmods = od->pmods;
+		on->amods = od->amods;
+		if (params & SAU_POPP_WAVE) {
+			uint32_t wave = *(const uint32_t*)
+				SAU_ProgramOpData_VALUE(od, SAU_POPP_WAVE);
+			o->waves[od->id] = (wave < SAU_WAVE_TYPES) ?
+				wave : SAU_WAVE_SIN;
+		}
+		if (params & SAU_POPP_TIME) {
+			if (od->time.flags & SAU_TIMEP_LINKED) {
+				on->time = 0;
+				on->flags |= ON_TIME_INF;
+			} else {
+				on->time = SAU_MS_IN_SAMPLES(od->time.v_ms,
+						srate);
+				on->flags &= ~ON_TIME_INF;
+			}
+		}
+		if (params & SAU_POPP_SILENCE)
+			on->silence = SAU_MS_IN_SAMPLES(*(const uint32_t*)
+				SAU_ProgramOpData_VALUE(od, SAU_POPP_SILENCE),
+				srate);
+	}
+	if (prg_e->vo_id != SAU_PVO_NO_ID) {
+		VoiceNode *vn = &o->pa.voices[prg_e->vo_id];
+		if (e->graph != NULL) {
+			vn->graph = e->graph;
+			vn->graph_count = e->graph_count;
+		}
+		uint32_t time = 0;
+		for (uint32_t i = 0; i < vn->graph_count; ++i) {
+			const SAU_ProgramOpRef *or = &vn->graph[i];
+			if (or->use != SAU_POP_CARR) continue;
+			OperatorNode *on = &o->pa.operators[or->id];
+			if (on->time > time)
+				time = on->time;
+		}
+		vn->duration = time;
+	}
+}
+
+/**
+ * Estimate cost of rendering program \p prg at sample rate \p srate,
+ * using \p calib for CPU time, or leaving it zero if NULL.
+ *
+ * \return true, or false on allocation failure or invalid data
+ */
+bool SAU_estimate_Cost(SAU_Cost *restrict o,
+		const SAU_Program *restrict prg, uint32_t srate,
+		const SAU_CostCalib *restrict calib) {
+	CostWalk w = (CostWalk){0};
+	bool ok = false;
+	*o = (SAU_Cost){0};
+	o->srate = srate;
+	o->buf_size = SAU_MIX_BUFLEN * sizeof(float);
+	w.cost = o;
+	SAU_MemPool *mem = SAU_obtain_MemPool(0);
+	if (!mem)
+		goto MEM_ERR;
+	if (!SAU_fill_PreAlloc(&w.pa, prg, srate, mem) ||
+	    !SAU_PreAlloc_prepare(&w.pa, prg->ev_count))
+		goto DONE;
+	if (prg->op_count > 0) {
+		w.waves = SAU_MemPool_alloc(mem, prg->op_count);
+		if (!w.waves) goto MEM_ERR;
+	}
+	for (size_t i = 0; i < w.pa.ev_count; ++i) {
+		const EventNode *e = &w.pa.events[i];
+		if (e->wait > 0) walk_voices(&w, e->wait);
+		handle_event(&w, e);
+	}
+	for (;;) {
+		uint32_t len = 0;
+		for (uint32_t i = 0; i < w.pa.vo_count; ++i) {
+			const VoiceNode *vn = &w.pa.voices[i];
+			if (vn->graph != NULL && vn->duration > len)
+				len = vn->duration;
+		}
+		if (!len) break;
+		walk_voices(&w, len);
+	}
+	o->samples = w.pos;
+	o->max_bufs = w.pa.max_bufs;
+	if (calib != NULL) {
+		double ns = o->pm_samples * (double) calib->pm_ns +
+			o->env_samples * (double) calib->env_ns +
+			o->ramp_samples * (double) calib->ramp_ns +
+			o->mix_samples * (double) calib->mix_ns +
+			o->samples * (double) calib->out_ns;
+		for (int i = 0; i < SAU_WAVE_TYPES; ++i)
+			ns += o->op_samples[i] * (double) calib->osc_ns[i];
+		o->cpu_secs = ns * 1e-9 * calib->scale;
+	}
+	ok = true;
+	if (false)
+	MEM_ERR: {
+		SAU_error("cost", "memory allocation failure");
+	}
+DONE:
+	SAU_fini_PreAlloc(&w.pa);
+	SAU_release_MemPool(mem);
+	return ok;
+}
+
+/*
+ * Kernel calibration.
+ */
+
+#define CALIB_FILE  "calib-%s.saucost" // with host name
+#define CALIB_MAGIC "saugns-calib"
+#define CALIB_LEN   SAU_MIX_BUFLEN
+#define CALIB_RUNS  64
+#define CALIB_TRIES 5
+#define CALIB_SRATE 48000
+#define CALIB_NOTES 128
+
+/*
+ * Lines of script run to find the overhead beyond the kernels,
+ * as overlapping notes using each kind of modulation.
+ */
+#define CALIB_LINE_TYPES 4
+static const char *const calib_lines[CALIB_LINE_TYPES] = {
+	"\\0.01 Osin f%u t0.2 p+[Osin r2 a0.5 f~[Osin r0.3]]\n",
+	"\\0.01 Osaw f%u t0.2 a0.5,1~[Osin f3]\n",
+	"\\0.01 Otri f%u,440~[Osin r1.5] t0.2\n",
+	"\\0.01 Osqr f%u t0.2 a0.5\n",
+};
+
+#define CALIB_LINE_MAX 64
+#define CALIB_ID_MAX   256
+
+/*
+ * Buffers for timing kernels.
+ */
+typedef struct CalibBufs {
+	float out[CALIB_LEN];
+	float freq[CALIB_LEN];
+	float amp[CALIB_LEN];
+	float pm[CALIB_LEN];
+	int16_t out_i16[CALIB_LEN * 2];
+} CalibBufs;
+
+/*
+ * Kernels timed, after one for each wave type. Those for
+ * modulation are timed with sine, less the time without.
+ */
+enum {
+	KERNEL_PM = SAU_WAVE_TYPES,
+	KERNEL_ENV,
+	KERNEL_RAMP,
+	KERNEL_MIX,
+	KERNEL_OUT,
+	KERNELS,
+	CALIB_VALUES = KERNELS + 1 // with scale
+};
+
+static const char *const kernel_names[CALIB_VALUES - SAU_WAVE_TYPES] = {
+	"pm",
+	"env",
+	"ramp",
+	"mix",
+	"out",
+	"scale",
+};
+
+/*
+ * Get calibration value for kernel \p kernel, or the scale.
+ */
+static float *get_calib_ns(SAU_CostCalib *restrict calib, int kernel) {
+	switch (kernel) {
+	case KERNEL_PM: return &calib->pm_ns;
+	case KERNEL_ENV: return &calib->env_ns;
+	case KERNEL_RAMP: return &calib->ramp_ns;
+	case KERNEL_MIX: return &calib->mix_ns;
+	case KERNEL_OUT: return &calib->out_ns;
+	case KERNELS: return &calib->scale;
+	default: return &calib->osc_ns[kernel];
+	}
+}
+
+/*
+ * Run kernel \p kernel once.
+ */
+static void run_kernel(int kernel, CalibBufs *restrict b,
+		SAU_Osc *restrict osc, SAU_Mixer *restrict mixer) {
+	static SAU_Ramp pan; /* fixed, as used by default */
+	uint32_t pan_pos = 0;
+	int16_t *out = b->out_i16;
+	switch (kernel) {
+	case KERNEL_PM:
+		osc->lut = SAU_Osc_LUT(SAU_WAVE_SIN);
+		SAU_Osc_run(osc, b->out, CALIB_LEN, 0, b->freq, b->amp, b->pm);
+		break;
+	case KERNEL_ENV:
+		osc->lut = SAU_Osc_LUT(SAU_WAVE_SIN);
+		SAU_Osc_run_env(osc, b->out, CALIB_LEN, 0,
+				b->freq, b->amp, NULL);
+		break;
+	case KERNEL_RAMP:
+		SAU_Ramp_fill_lin(b->amp, CALIB_LEN, 0.f, 1.f,
+				0, CALIB_LEN, NULL);
+		break;
+	case KERNEL_MIX:
+		SAU_Mixer_add(mixer, b->out, CALIB_LEN, &pan, &pan_pos);
+		break;
+	case KERNEL_OUT:
+		SAU_Mixer_write(mixer, &out, CALIB_LEN);
+		SAU_Mixer_clear(mixer);
+		break;
+	default:
+		osc->lut = SAU_Osc_LUT(kernel);
+		SAU_Osc_run(osc, b->out, CALIB_LEN, 0, b->freq, b->amp, NULL);
+		break;
+	}
+}
+
+/*
+ * Time kernels on this host, keeping the fastest of some tries.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool measure_kernels(SAU_CostCalib *restrict calib) {
+	CalibBufs *b = calloc(1, sizeof(CalibBufs));
+	SAU_Mixer *mixer = SAU_create_Mixer();
+	bool ok = false;
+	if (!b || !mixer)
+		goto DONE;
+	SAU_global_init_Wave();
+	SAU_Osc osc;
+	SAU_init_Osc(&osc, SAU_DEFAULT_SRATE);
+	for (size_t i = 0; i < CALIB_LEN; ++i) {
+		b->freq[i] = 440.f;
+		b->amp[i] = 1.f;
+		b->pm[i] = (float) i / CALIB_LEN;
+	}
+	for (int k = 0; k < KERNELS; ++k) {
+		double best = -1.0;
+		for (int t = 0; t < CALIB_TRIES; ++t) {
+			uint64_t t0 = SAU_time_ns();
+			for (int r = 0; r < CALIB_RUNS; ++r)
+				run_kernel(k, b, &osc, mixer);
+			double ns = (SAU_time_ns() - t0) /
+				((double) CALIB_RUNS * CALIB_LEN);
+			if (best < 0.0 || ns < best) best = ns;
+		}
+		if (k == KERNEL_PM || k == KERNEL_ENV) {
+			best -= calib->osc_ns[SAU_WAVE_SIN];
+			if (best < 0.0) best = 0.0;
+		}
+		*get_calib_ns(calib, k) = best;
+	}
+	ok = true;
+DONE:
+	SAU_destroy_Mixer(mixer);
+	free(b);
+	return ok;
+}
+
+/*
+ * Time running a script, to scale the estimate from kernel times
+ * by the overhead of running these in blocks for voice graphs.
+ *
+ * \return true, or false on failure
+ */
+static bool measure_scale(SAU_CostCalib *restrict calib) {
+	SAU_Program *prg = NULL;
+	char *script = malloc(CALIB_NOTES * CALIB_LINE_MAX);
+	int16_t *buf = malloc(CALIB_LEN * 2 * sizeof(int16_t));
+	SAU_Cost cost;
+	double best = -1.0;
+	bool ok = false;
+	calib->scale = 1.f;
+	if (!script || !buf)
+		goto DONE;
+	for (size_t i = 0, len = 0; i < CALIB_NOTES; ++i)
+		len += snprintf(&script[len], CALIB_LINE_MAX,
+				calib_lines[i % CALIB_LINE_TYPES],
+				(unsigned) (100 + (i * 37) % 1900));
+	prg = SAU_load_Program(script, false);
+	if (!prg ||
+	    !SAU_estimate_Cost(&cost, prg, CALIB_SRATE, calib))
+		goto DONE;
+	for (int t = 0; t < CALIB_TRIES; ++t) {
+		SAU_Interp *gen = SAU_create_Interp(prg, CALIB_SRATE, false);
+		if (!gen)
+			goto DONE;
+		uint64_t t0 = SAU_time_ns();
+		while (SAU_Interp_run(gen, buf, CALIB_LEN) > 0)
+			;
+		double ns = SAU_time_ns() - t0;
+		if (best < 0.0 || ns < best) best = ns;
+		SAU_destroy_Interp(gen);
+	}
+	if (cost.cpu_secs > 0.0)
+		calib->scale = best * 1e-9 / cost.cpu_secs;
+	ok = true;
+DONE:
+	free(script);
+	free(buf);
+	SAU_discard_Program(prg);
+	return ok;
+}
+
+/*
+ * Host identity, as calibration only applies to the same machine.
+ */
+typedef struct HostID {
+	char host[CALIB_ID_MAX];
+	char cpu[CALIB_ID_MAX];
+} HostID;
+
+/*
+ * Get host name, made safe for use in a file name, and CPU model
+ * name where the system lists it. Missing parts are "unknown".
+ */
+static void get_HostID(HostID *restrict id) {
+	if (gethostname(id->host, sizeof(id->host)) != 0)
+		id->host[0] = '\0';
+	id->host[sizeof(id->host) - 1] = '\0';
+	for (char *c = id->host; *c != '\0'; ++c)
+		if (!isalnum((unsigned char) *c) && *c != '-' && *c != '.')
+			*c = '_';
+	if (id->host[0] == '\0' || id->host[0] == '.')
+		strcpy(id->host, "unknown");
+	strcpy(id->cpu, "unknown");
+	FILE *f = fopen("/proc/cpuinfo", "rb");
+	if (!f)
+		return;
+	char line[CALIB_ID_MAX];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (strncmp(line, "model name", 10) != 0)
+			continue;
+		char *val = strchr(line, ':');
+		if (!val)
+			break;
+		val += 1 + strspn(val + 1, " \t");
+		val[strcspn(val, "\n")] = '\0';
+		if (*val != '\0')
+			strcpy(id->cpu, val);
+		break;
+	}
+	fclose(f);
+}
+
+/*
+ * Read line "<key> <value>" from \p f, checking that it matches.
+ *
+ * \return true if matching
+ */
+static bool read_id_line(FILE *restrict f,
+		const char *restrict key, const char *restrict value) {
+	char line[CALIB_ID_MAX + 16];
+	size_t key_len = strlen(key);
+	if (!fgets(line, sizeof(line), f))
+		return false;
+	line[strcspn(line, "\n")] = '\0';
+	return !strncmp(line, key, key_len) && line[key_len] == ' ' &&
+		!strcmp(&line[key_len + 1], value);
+}
+
+/*
+ * Read calibration written by the same version on the same host,
+ * as given by \p id, from \p f.
+ *
+ * \return true if complete
+ */
+static bool read_calib(SAU_CostCalib *restrict calib,
+		const HostID *restrict id, FILE *restrict f) {
+	char magic[32], version[32], name[32];
+	if (fscanf(f, "%31s %31s\n", magic, version) != 2 ||
+	    strcmp(magic, CALIB_MAGIC) || strcmp(version, SAU_VERSION_STR) ||
+	    !read_id_line(f, "host", id->host) ||
+	    !read_id_line(f, "cpu", id->cpu))
+		return false;
+	for (int k = 0; k < CALIB_VALUES; ++k) {
+		const char *kernel_name = (k < SAU_WAVE_TYPES) ?
+			SAU_Wave_names[k] : kernel_names[k - SAU_WAVE_TYPES];
+		const char *fmt = (k < SAU_WAVE_TYPES) ?
+			" osc %31s %f" : " %31s %f";
+		if (fscanf(f, fmt, name, get_calib_ns(calib, k)) != 2 ||
+		    strcmp(name, kernel_name))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Write calibration to \p path, replacing any old file
+ * once successfully written.
+ */
+static void write_calib(SAU_CostCalib *restrict calib,
+		const HostID *restrict id,
+		const char *restrict path, char *restrict tmp_path) {
+	FILE *f = fopen(tmp_path, "wb");
+	bool ok = false;
+	if (f != NULL) {
+		fprintf(f, CALIB_MAGIC" "SAU_VERSION_STR"\n");
+		fprintf(f, "host %s\ncpu %s\n", id->host, id->cpu);
+		for (int k = 0; k < CALIB_VALUES; ++k) {
+			float ns = *get_calib_ns(calib, k);
+			if (k < SAU_WAVE_TYPES)
+				fprintf(f, "osc %s %.4f\n",
+						SAU_Wave_names[k], ns);
+			else
+				fprintf(f, "%s %.4f\n",
+						kernel_names[k - SAU_WAVE_TYPES],
+						ns);
+		}
+		ok = !ferror(f);
+		if (fclose(f) != 0) ok = false;
+		if (ok) ok = (rename(tmp_path, path) == 0);
+		if (!ok) remove(tmp_path);
+	}
+	if (!ok)
+		SAU_warning("cost", "couldn't write calibration file \"%s\"",
+				path);
+}
+
+/**
+ * Get kernel timing for this host. If \p cache_dir is not NULL,
+ * calibration kept in it is used, or else written to it. The file
+ * is named after the host, and also checked for the CPU model.
+ *
+ * \return true, or false on allocation failure
+ */
+bool SAU_calibrate_Cost(SAU_CostCalib *restrict calib,
+		const char *restrict cache_dir) {
+	char *path = NULL, *tmp_path = NULL;
+	HostID id;
+	bool ok = false;
+	*calib = (SAU_CostCalib){0};
+	if (cache_dir != NULL) {
+		get_HostID(&id);
+		size_t len = strlen(cache_dir) + strlen(id.host) +
+			sizeof("/"CALIB_FILE);
+		path = malloc(len);
+		tmp_path = malloc(len + sizeof(".tmp") - 1);
+		if (!path || !tmp_path) goto DONE;
+		snprintf(path, len, "%s/"CALIB_FILE, cache_dir, id.host);
+		snprintf(tmp_path, len + sizeof(".tmp") - 1, "%s.tmp", path);
+		FILE *f = fopen(path, "rb");
+		if (f != NULL) {
+			bool read = read_calib(calib, &id, f);
+			fclose(f);
+			if (read) {
+				ok = true;
+				goto DONE;
+			}
+		}
+	}
+	if (!measure_kernels(calib) || !measure_scale(calib))
+		goto DONE;
+	if (path != NULL)
+		write_calib(calib, &id, path, tmp_path);
+	ok = true;
+DONE:
+	if (!ok)
+		SAU_error("cost", "calibration failed");
+	free(path);
+	free(tmp_path);
+	return ok;
+}
+
+/**
+ * Print cost estimate for program named \p name.
+ */
+void SAU_Cost_print(const SAU_Cost *restrict o,
+		const char *restrict name) {
+	uint64_t op_samples = 0;
+	double secs = (double) o->samples / o->srate;
+	fprintf(stdout, "Cost: \"%s\" at %u Hz\n", name, o->srate);
+	fprintf(stdout, "\tLength:  \t%.3f s\n", secs);
+	fputs("\tWaves:   \t", stdout);
+	for (int i = 0; i < SAU_WAVE_TYPES; ++i) {
+		if (!o->op_samples[i]) continue;
+		fprintf(stdout, "%s%s %.3f M",
+				(op_samples > 0) ? ", " : "",
+				SAU_Wave_names[i], o->op_samples[i] * 1e-6);
+		op_samples += o->op_samples[i];
+	}
+	if (!op_samples) fputs("none", stdout);
+	fputs(" op-samples\n", stdout);
+	fprintf(stdout,
+		"\tMods:    \t%.3f M op-samples, nested %u deep; %.3f M muted\n",
+		o->mod_samples * 1e-6, o->max_depth, o->muted_samples * 1e-6);
+	fprintf(stdout,
+		"\tVoices:  \t%u at peak (at %u ms), %.3f M samples mixed\n",
+		o->peak_voices, o->peak_ms, o->mix_samples * 1e-6);
+	fprintf(stdout,
+		"\tScratch: \t%u buffers of %zu (%zu)\n",
+		o->max_bufs, o->buf_size, o->max_bufs * o->buf_size);
+	if (o->cpu_secs > 0.0)
+		fprintf(stdout,
+			"\tCPU:     \t%.3f s estimated (%.1f%% of real time)\n",
+			o->cpu_secs,
+			(secs > 0.0) ? 100.0 * o->cpu_secs / secs : 0.0);
+}
@@ -0,0 +1,63 @@
+/* saugns: Audio program render cost estimator.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "../program.h"
+#include "../wave.h"
+
+/**
+ * Host timing of the kernels used to generate audio,
+ * in nanoseconds per sample.
+ */
+typedef struct SAU_CostCalib {
+	float osc_ns[SAU_WAVE_TYPES]; // per wave type
+	float pm_ns; // added for phase modulation input
+	float env_ns; // added for FM and AM modulator output
+	float ramp_ns; // parameter value fill
+	float mix_ns; // panning and mixing of voice output
+	float out_ns; // clipping and writing of output
+	float scale; // ratio of time running to sum of kernel times
+} SAU_CostCalib;
+
+/**
+ * Render cost estimate for a program, from walking its events
+ * and voice graphs without generating audio.
+ *
+ * Operator-samples are samples generated by an operator; those of
+ * muted operators are counted apart, as they are not generated.
+ */
+typedef struct SAU_Cost {
+	uint32_t srate;
+	uint64_t samples; // output length
+	uint64_t op_samples[SAU_WAVE_TYPES];
+	uint64_t mod_samples; // part of the above for modulators
+	uint64_t pm_samples; // part of the above with PM input
+	uint64_t env_samples; // part of the above for FM and AM
+	uint64_t muted_samples;
+	uint64_t ramp_samples; // parameter values filled or mixed
+	uint64_t mix_samples; // voice output mixed
+	uint32_t max_depth; // deepest modulator nesting run
+	uint32_t peak_voices;
+	uint32_t peak_ms; // time when first at peak
+	uint32_t max_bufs; // scratch buffers needed
+	size_t buf_size; // bytes per scratch buffer
+	double cpu_secs; // estimated, given calibration
+} SAU_Cost;
+
+bool SAU_calibrate_Cost(SAU_CostCalib *restrict calib,
+		const char *restrict cache_dir);
+bool SAU_estimate_Cost(SAU_Cost *restrict o,
+		const SAU_Program *restrict prg, uint32_t srate,
+		const SAU_CostCalib *restrict calib);
+void SAU_Cost_print(const SAU_Cost *restrict o,
+		const char *restrict name);
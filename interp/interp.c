@@ -15,10 +15,28 @@
 #include "prealloc.h"
 #include "mixer.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define BUF_LEN SAU_MIX_BUFLEN
 typedef float Buf[BUF_LEN];
 
+/* number of events prepared at a time, ahead of the playhead */
+#define PREPARE_EVENTS 256
+
+/*
+ * Below this fraction of the budget, a dropped voice is restored.
+ */
+#define BUDGET_RESTORE 0.5f
+
+/*
+ * Voice ranked by current amplitude, for dropping the quietest.
+ */
+typedef struct VoiceLevel {
+	float level;
+	uint32_t id;
+} VoiceLevel;
+
 struct SAU_Interp {
 	const SAU_Program *prg;
 	uint32_t srate;
@@ -26,32 +44,113 @@ struct SAU_Interp {
 	Buf *bufs;
 	SAU_Mixer *mixer;
 	size_t event, ev_count;
-	EventNode **events;
 	uint32_t event_pos;
 	uint16_t voice, vo_count;
 	VoiceNode *voices;
 	OperatorNode *operators;
+	SAU_PreAlloc pa;
 	SAU_MemPool *mem;
+	float budget;
+	uint32_t drop_count, playing;
+	VoiceLevel *levels;
+	SAU_InterpBudgetStats budget_stats;
+	SAU_InterpProfile *prof;
+	SAU_InterpTrace *trace;
 };
 
+/*
+ * \return start time for kernel run, or 0 if not profiling
+ */
+static inline uint64_t prof_start(const SAU_Interp *restrict o) {
+	return (o->prof != NULL) ? SAU_time_ns() : 0;
+}
+
+/*
+ * If profiling, add time since \p start for a run of \p kernel over
+ * \p len samples, for operator node \p n if not NULL.
+ */
+static inline void prof_add(SAU_Interp *restrict o, uint64_t start,
+		uint32_t kernel, uint32_t len,
+		const OperatorNode *restrict n) {
+	SAU_InterpProfile *prof = o->prof;
+	if (!prof)
+		return;
+	uint64_t ns = SAU_time_ns() - start;
+	prof->kernel_ns[kernel] += ns;
+	prof->kernel_samples[kernel] += len;
+	if (n != NULL)
+		prof->ops[n - o->operators].ns += ns;
+}
+
+/*
+ * \return start time for span, or 0 if not tracing
+ */
+static inline uint64_t span_start(const SAU_Interp *restrict o) {
+	return (o->trace != NULL) ? SAU_time_ns() : 0;
+}
+
+/*
+ * If tracing, record span of \p kind from \p start until now,
+ * unless out of room.
+ */
+static inline void span_add(SAU_Interp *restrict o, uint64_t start,
+		uint32_t kind, uint32_t n) {
+	SAU_InterpTrace *trace = o->trace;
+	if (!trace)
+		return;
+	if (trace->count == trace->max) {
+		++trace->dropped;
+		return;
+	}
+	trace->spans[trace->count++] =
+		(SAU_InterpSpan){start, SAU_time_ns(), n, kind};
+}
+
+/*
+ * Prepare events up to, not including, \p ev_end, and allocate
+ * more buffers if needed for their voice graphs. On failure, the
+ * events not prepared are dropped, so that the signal ends early.
+ *
+ * \return true, or false on allocation failure or invalid data
+ */
+static bool prepare_events(SAU_Interp *restrict o, size_t ev_end) {
+	size_t ev_start = o->pa.ev_prepared;
+	if (ev_end <= ev_start)
+		return true;
+	uint64_t t = span_start(o);
+	if (!SAU_PreAlloc_prepare(&o->pa, ev_end))
+		goto ERROR;
+	span_add(o, t, SAU_SPAN_PREPARE, o->pa.ev_prepared - ev_start);
+	if (o->pa.max_bufs > o->buf_count) {
+		uint32_t count = o->buf_count * 2;
+		if (count < o->pa.max_bufs)
+			count = o->pa.max_bufs;
+		Buf *bufs = SAU_MemPool_alloc(o->mem, count * sizeof(Buf));
+		if (!bufs) {
+			SAU_error("interp", "memory allocation failure");
+			goto ERROR;
+		}
+		o->bufs = bufs;
+		o->buf_count = count;
+	}
+	return true;
+ERROR:
+	o->ev_count = ev_start;
+	return false;
+}
+
 static bool init_for_program(SAU_Interp *restrict o,
-		const SAU_Program *restrict prg, uint32_t srate) {
-	SAU_PreAlloc pa;
-	if (!SAU_fill_PreAlloc(&pa, prg, srate, o->mem))
+		const SAU_Program *restrict prg, uint32_t srate, bool lazy) {
+	if (!SAU_fill_PreAlloc(&o->pa, prg, srate, o->mem))
 		return false;
 	o->prg = prg;
 	o->srate = srate;
-	o->events = pa.events;
-	o->ev_count = pa.ev_count;
-	o->operators = pa.operators;
-	o->voices = pa.voices;
-	o->vo_count = pa.vo_count;
-	if (pa.max_bufs > 0) {
-		o->bufs = SAU_MemPool_alloc(o->mem,
-				pa.max_bufs * sizeof(Buf));
-		if (!o->bufs) goto ERROR;
-		o->buf_count = pa.max_bufs;
-	}
+	o->ev_count = o->pa.ev_count;
+	o->operators = o->pa.operators;
+	o->voices = o->pa.voices;
+	o->vo_count = o->pa.vo_count;
+	if (!prepare_events(o, lazy ? PREPARE_EVENTS : o->ev_count))
+		goto ERROR;
 	o->mixer = SAU_create_Mixer();
 	if (!o->mixer) goto ERROR;
 
@@ -67,19 +166,25 @@ ERROR:
 
 /**
  * Create instance for program \p prg and sample rate \p srate.
+ *
+ * All events are prepared, unless \p lazy is true; then they are
+ * prepared a little at a time while running, keeping event nodes
+ * only for those coming up, and the signal ends early on failure.
+ *
+ * \return instance, or NULL on allocation failure or invalid data
  */
 SAU_Interp *SAU_create_Interp(const SAU_Program *restrict prg,
-		uint32_t srate) {
-	SAU_MemPool *mem = SAU_create_MemPool(0);
+		uint32_t srate, bool lazy) {
+	SAU_MemPool *mem = SAU_obtain_MemPool(0);
 	if (!mem)
 		return NULL;
 	SAU_Interp *o = SAU_MemPool_alloc(mem, sizeof(SAU_Interp));
 	if (!o) {
-		SAU_destroy_MemPool(mem);
+		SAU_release_MemPool(mem);
 		return NULL;
 	}
 	o->mem = mem;
-	if (!init_for_program(o, prg, srate)) {
+	if (!init_for_program(o, prg, srate, lazy)) {
 		SAU_destroy_Interp(o);
 		return NULL;
 	}
@@ -93,8 +198,108 @@ SAU_Interp *SAU_create_Interp(const SAU_Program *restrict prg,
 void SAU_destroy_Interp(SAU_Interp *restrict o) {
 	if (!o)
 		return;
+	SAU_fini_PreAlloc(&o->pa);
 	SAU_destroy_Mixer(o->mixer);
-	SAU_destroy_MemPool(o->mem);
+	SAU_release_MemPool(o->mem);
+}
+
+/**
+ * Prepare all remaining events now, for an instance created lazy.
+ * After this, running doesn't allocate memory or print errors.
+ *
+ * \return true, or false on allocation failure or invalid data
+ */
+bool SAU_Interp_prepare(SAU_Interp *restrict o) {
+	return prepare_events(o, o->ev_count);
+}
+
+/**
+ * Enable real-time mode, in which each run is timed against the
+ * audio time produced. When a run takes longer than \p max_load
+ * times the audio time, the quietest voices are dropped for the
+ * following runs, and restored again once well within budget.
+ * Dropped voices keep time, but produce no output.
+ *
+ * Pass zero for \p max_load to disable.
+ *
+ * \return true, or false on allocation failure
+ */
+bool SAU_Interp_set_budget(SAU_Interp *restrict o, float max_load) {
+	if (max_load > 0.f && !o->levels && o->vo_count > 0) {
+		o->levels = SAU_MemPool_alloc(o->mem,
+				o->vo_count * sizeof(VoiceLevel));
+		if (!o->levels) {
+			SAU_error("interp", "memory allocation failure");
+			return false;
+		}
+	}
+	o->budget = max_load;
+	o->budget_stats = (SAU_InterpBudgetStats){0};
+	o->drop_count = 0;
+	for (uint32_t i = 0; i < o->vo_count; ++i)
+		o->voices[i].flags &= ~VN_DROP;
+	return true;
+}
+
+/**
+ * Enable or disable profiling, in which time spent in each kernel
+ * is measured, and added up per operator and per voice along with
+ * samples generated. To be enabled before running.
+ *
+ * \return true, or false on allocation failure
+ */
+bool SAU_Interp_set_profile(SAU_Interp *restrict o, bool enable) {
+	if (!enable) {
+		o->prof = NULL;
+		return true;
+	}
+	SAU_InterpProfile *prof = SAU_MemPool_alloc(o->mem,
+			sizeof(SAU_InterpProfile));
+	if (!prof) goto MEM_ERR;
+	prof->op_count = o->pa.op_count;
+	prof->vo_count = o->vo_count;
+	if (prof->op_count > 0) {
+		prof->ops = SAU_MemPool_alloc(o->mem,
+				prof->op_count * sizeof(SAU_InterpOpProfile));
+		if (!prof->ops) goto MEM_ERR;
+	}
+	if (prof->vo_count > 0) {
+		prof->voices = SAU_MemPool_alloc(o->mem,
+				prof->vo_count * sizeof(SAU_InterpVoiceProfile));
+		if (!prof->voices) goto MEM_ERR;
+	}
+	o->prof = prof;
+	return true;
+MEM_ERR:
+	SAU_error("interp", "memory allocation failure");
+	return false;
+}
+
+/**
+ * Enable tracing, in which spans of running are recorded, with room
+ * for \p max_spans between the times they're taken; see
+ * SAU_Interp_get_trace(). Pass zero to disable. To be enabled before
+ * running; recording doesn't allocate memory or write anything.
+ *
+ * \return true, or false on allocation failure
+ */
+bool SAU_Interp_set_trace(SAU_Interp *restrict o, uint32_t max_spans) {
+	if (!max_spans) {
+		o->trace = NULL;
+		return true;
+	}
+	SAU_InterpTrace *trace = SAU_MemPool_alloc(o->mem,
+			sizeof(SAU_InterpTrace));
+	if (!trace) goto MEM_ERR;
+	trace->spans = SAU_MemPool_alloc(o->mem,
+			max_spans * sizeof(SAU_InterpSpan));
+	if (!trace->spans) goto MEM_ERR;
+	trace->max = max_spans;
+	o->trace = trace;
+	return true;
+MEM_ERR:
+	SAU_error("interp", "memory allocation failure");
+	return false;
 }
 
 /*
@@ -137,15 +342,36 @@ static void handle_event(SAU_Interp *restrict o, EventNode *restrict e) {
 		 * updates for their operators.
 		 */
 		const SAU_ProgramEvent *prg_e = e->prg_e;
-		for (size_t i = 0; i < prg_e->op_data_count; ++i) {
-			const SAU_ProgramOpData *od = &prg_e->op_data[i];
+		const SAU_ProgramOpData *od = prg_e->op_data;
+		for (size_t i = 0; i < prg_e->op_data_count;
+				++i, od = SAU_ProgramOpData_next(od)) {
 			OperatorNode *on = &o->operators[od->id];
 			uint32_t params = od->params;
+			const uint8_t *v = od->values;
+			if (!od->prev) {
+				/*
+				 * New operator, possibly reusing the ID.
+				 */
+				*on = (OperatorNode){0};
+				SAU_init_Osc(&on->osc, o->srate);
+				if (params & SAU_POPF_MUTE)
+					on->flags |= ON_MUTE;
+				if (o->prof != NULL)
+					o->prof->ops[od->id].wave = SAU_WAVE_SIN;
+			}
 			on->fmods = od->fmods;
 			on->pmods = od->pmods;
 			on->amods = od->amods;
-			if (params & SAU_POPP_WAVE)
-				on->osc.lut = SAU_Osc_LUT(od->wave);
+			/*
+			 * Values are stored in order of parameter flags.
+			 */
+			if (params & SAU_POPP_WAVE) {
+				uint32_t wave = *(const uint32_t*) v;
+				on->osc.lut = SAU_Osc_LUT(wave);
+				if (o->prof != NULL)
+					o->prof->ops[od->id].wave = wave;
+				v += SAU_POPV_WORD_SIZE;
+			}
 			if (params & SAU_POPP_TIME) {
 				const SAU_Time *src = &od->time;
 				if (src->flags & SAU_TIMEP_LINKED) {
@@ -157,23 +383,33 @@ static void handle_event(SAU_Interp *restrict o, EventNode *restrict e) {
 					on->flags &= ~ON_TIME_INF;
 				}
 			}
-			if (params & SAU_POPP_SILENCE)
-				on->silence = SAU_MS_IN_SAMPLES(od->silence_ms,
-						o->srate);
-			if (params & SAU_POPP_FREQ)
+			if (params & SAU_POPP_SILENCE) {
+				on->silence = SAU_MS_IN_SAMPLES(
+						*(const uint32_t*) v, o->srate);
+				v += SAU_POPV_WORD_SIZE;
+			}
+			if (params & SAU_POPP_FREQ) {
 				handle_ramp_update(&on->freq,
-						&on->freq_pos, &od->freq);
-			if (params & SAU_POPP_FREQ2)
+						&on->freq_pos, (const SAU_Ramp*) v);
+				v += SAU_POPV_RAMP_SIZE;
+			}
+			if (params & SAU_POPP_FREQ2) {
 				handle_ramp_update(&on->freq2,
-						&on->freq2_pos, &od->freq2);
-			if (params & SAU_POPP_PHASE)
-				on->osc.phase = SAU_Osc_PHASE(od->phase);
-			if (params & SAU_POPP_AMP)
+						&on->freq2_pos, (const SAU_Ramp*) v);
+				v += SAU_POPV_RAMP_SIZE;
+			}
+			if (params & SAU_POPP_PHASE) {
+				on->osc.phase = SAU_Osc_PHASE(*(const float*) v);
+				v += SAU_POPV_WORD_SIZE;
+			}
+			if (params & SAU_POPP_AMP) {
 				handle_ramp_update(&on->amp,
-						&on->amp_pos, &od->amp);
+						&on->amp_pos, (const SAU_Ramp*) v);
+				v += SAU_POPV_RAMP_SIZE;
+			}
 			if (params & SAU_POPP_AMP2)
 				handle_ramp_update(&on->amp2,
-						&on->amp2_pos, &od->amp2);
+						&on->amp2_pos, (const SAU_Ramp*) v);
 		}
 		if (prg_e->vo_id != SAU_PVO_NO_ID) {
 			const SAU_ProgramVoData *vd = prg_e->vo_data;
@@ -182,11 +418,16 @@ static void handle_event(SAU_Interp *restrict o, EventNode *restrict e) {
 			if (e->graph != NULL) {
 				vn->graph = e->graph;
 				vn->graph_count = e->graph_count;
+				if (o->prof != NULL)
+					for (uint32_t i = 0; i < e->graph_count; ++i)
+						o->prof->ops[e->graph[i].id].uses |=
+							1 << e->graph[i].use;
 			}
 			if (params & SAU_PVOP_PAN)
 				handle_ramp_update(&vn->pan,
 						&vn->pan_pos, &vd->pan);
-			vn->flags |= VN_INIT;
+			/* play any new note, until next selection of drops */
+			vn->flags = (vn->flags | VN_INIT) & ~VN_DROP;
 			vn->pos = 0;
 			if (o->voice > prg_e->vo_id) {
 				/* go back to re-activated node */
@@ -214,6 +455,7 @@ static uint32_t run_block(SAU_Interp *restrict o,
 	uint32_t i, len = buf_len;
 	float *s_buf = *(bufs++), *pm_buf;
 	float *freq, *amp;
+	uint64_t prof_t;
 	/*
 	 * If silence, zero-fill and delay processing for duration.
 	 */
@@ -248,25 +490,38 @@ static uint32_t run_block(SAU_Interp *restrict o,
 		skip_len = len - n->time;
 		len = n->time;
 	}
+	/*
+	 * If output is zero throughout, skip all else but time update.
+	 */
+	if ((n->flags & ON_MUTE) != 0) {
+		if (!acc_ind || wave_env) for (i = 0; i < len; ++i)
+			s_buf[i] = 0;
+		goto UPDATE;
+	}
 	/*
 	 * Handle frequency, including frequency modulation
 	 * if modulators linked.
 	 */
 	freq = *(bufs++);
+	prof_t = prof_start(o);
 	SAU_Ramp_run(&n->freq, &n->freq_pos, freq, len, o->srate, parent_freq);
 	if (n->fmods->count > 0) {
 		float *freq2 = *(bufs++);
 		SAU_Ramp_run(&n->freq2, &n->freq2_pos,
 				freq2, len, o->srate, parent_freq);
+		prof_add(o, prof_t, SAU_PROF_RAMP, len, n);
 		const uint32_t *fmods = n->fmods->ids;
 		for (i = 0; i < n->fmods->count; ++i)
 			run_block(o, bufs, len, &o->operators[fmods[i]],
 					freq, true, i);
 		float *fm_buf = *bufs;
+		prof_t = prof_start(o);
 		for (i = 0; i < len; ++i)
 			freq[i] += (freq2[i] - freq[i]) * fm_buf[i];
+		prof_add(o, prof_t, SAU_PROF_COMBINE, len, n);
 	} else {
 		SAU_Ramp_skip(&n->freq2, &n->freq2_pos, len, o->srate);
+		prof_add(o, prof_t, SAU_PROF_RAMP, len, n);
 	}
 	/*
 	 * If phase modulators linked, get phase offsets for modulation.
@@ -284,28 +539,38 @@ static uint32_t run_block(SAU_Interp *restrict o,
 	 * modulators linked.
 	 */
 	amp = *(bufs++);
+	prof_t = prof_start(o);
 	SAU_Ramp_run(&n->amp, &n->amp_pos, amp, len, o->srate, NULL);
 	if (n->amods->count > 0) {
 		float *amp2 = *(bufs++);
 		SAU_Ramp_run(&n->amp2, &n->amp2_pos, amp2, len, o->srate, NULL);
+		prof_add(o, prof_t, SAU_PROF_RAMP, len, n);
 		const uint32_t *amods = n->amods->ids;
 		for (i = 0; i < n->amods->count; ++i)
 			run_block(o, bufs, len, &o->operators[amods[i]],
 					freq, true, i);
 		float *am_buf = *bufs;
+		prof_t = prof_start(o);
 		for (i = 0; i < len; ++i)
 			amp[i] += (amp2[i] - amp[i]) * am_buf[i];
+		prof_add(o, prof_t, SAU_PROF_COMBINE, len, n);
 	} else {
 		SAU_Ramp_skip(&n->amp2, &n->amp2_pos, len, o->srate);
+		prof_add(o, prof_t, SAU_PROF_RAMP, len, n);
 	}
+	prof_t = prof_start(o);
 	if (!wave_env) {
 		SAU_Osc_run(&n->osc, s_buf, len, acc_ind, freq, amp, pm_buf);
 	} else {
 		SAU_Osc_run_env(&n->osc, s_buf, len, acc_ind, freq, amp, pm_buf);
 	}
+	prof_add(o, prof_t, SAU_PROF_OSC, len, n);
+	if (o->prof != NULL)
+		o->prof->ops[n - o->operators].samples += len;
 	/*
 	 * Update time duration left, zero rest of buffer if unfilled.
 	 */
+UPDATE:
 	if (!(n->flags & ON_TIME_INF)) {
 		if (!acc_ind && skip_len > 0) {
 			s_buf += len;
@@ -318,6 +583,72 @@ static uint32_t run_block(SAU_Interp *restrict o,
 	return zero_len + len;
 }
 
+/*
+ * Advance an operator node and its subnodes by up to \p len samples,
+ * like run_block() but without generating anything.
+ */
+static void skip_block(SAU_Interp *restrict o,
+		uint32_t len, OperatorNode *restrict n) {
+	uint32_t i;
+	if (n->silence) {
+		uint32_t zero_len = n->silence;
+		if (zero_len > len)
+			zero_len = len;
+		len -= zero_len;
+		if (!(n->flags & ON_TIME_INF)) n->time -= zero_len;
+		n->silence -= zero_len;
+		if (!len)
+			return;
+	}
+	if ((n->flags & ON_VISITED) != 0)
+		return;
+	n->flags |= ON_VISITED;
+	if (n->time < len && !(n->flags & ON_TIME_INF))
+		len = n->time;
+	if (!(n->flags & ON_MUTE)) {
+		SAU_Ramp_skip(&n->freq, &n->freq_pos, len, o->srate);
+		SAU_Ramp_skip(&n->freq2, &n->freq2_pos, len, o->srate);
+		SAU_Ramp_skip(&n->amp, &n->amp_pos, len, o->srate);
+		SAU_Ramp_skip(&n->amp2, &n->amp2_pos, len, o->srate);
+		for (i = 0; i < n->fmods->count; ++i)
+			skip_block(o, len, &o->operators[n->fmods->ids[i]]);
+		for (i = 0; i < n->pmods->count; ++i)
+			skip_block(o, len, &o->operators[n->pmods->ids[i]]);
+		for (i = 0; i < n->amods->count; ++i)
+			skip_block(o, len, &o->operators[n->amods->ids[i]]);
+	}
+	if (!(n->flags & ON_TIME_INF))
+		n->time -= len;
+	n->flags &= ~ON_VISITED;
+}
+
+/*
+ * Advance a dropped voice by up to BUF_LEN samples,
+ * keeping time without generating output.
+ *
+ * \return number of samples of silence in place of output
+ */
+static uint32_t skip_voice(SAU_Interp *restrict o,
+		VoiceNode *restrict vn, uint32_t len) {
+	const SAU_ProgramOpRef *ops = vn->graph;
+	uint32_t opc = vn->graph_count;
+	uint32_t time = vn->duration;
+	if (!ops)
+		return 0;
+	if (len > BUF_LEN) len = BUF_LEN;
+	if (time > len) time = len;
+	for (uint32_t i = 0; i < opc; ++i) {
+		if (ops[i].use != SAU_POP_CARR) continue;
+		OperatorNode *n = &o->operators[ops[i].id];
+		if (n->time == 0) continue;
+		skip_block(o, time, n);
+	}
+	SAU_Ramp_skip(&vn->pan, &vn->pan_pos, time, o->srate);
+	vn->duration -= time;
+	vn->pos += time;
+	return time;
+}
+
 /*
  * Generate up to BUF_LEN samples for a voice, mixed into the
  * mix buffers.
@@ -334,6 +665,7 @@ static uint32_t run_voice(SAU_Interp *restrict o,
 	uint32_t acc_ind = 0;
 	uint32_t time;
 	uint32_t i;
+	uint64_t vo_t = prof_start(o);
 	time = vn->duration;
 	if (len > BUF_LEN) len = BUF_LEN;
 	if (time > len) time = len;
@@ -348,23 +680,37 @@ static uint32_t run_voice(SAU_Interp *restrict o,
 		if (last_len > out_len) out_len = last_len;
 	}
 	if (out_len > 0) {
+		uint64_t prof_t = prof_start(o);
 		SAU_Mixer_add(o->mixer, o->bufs[0], out_len,
 				&vn->pan, &vn->pan_pos);
+		prof_add(o, prof_t, SAU_PROF_MIX, out_len, NULL);
 	}
 	vn->duration -= time;
 	vn->pos += time;
+	if (o->prof != NULL) {
+		SAU_InterpVoiceProfile *vp = &o->prof->voices[vn - o->voices];
+		vp->ns += SAU_time_ns() - vo_t;
+		vp->samples += out_len;
+	}
 	return out_len;
 }
 
+/*
+ * Position in output buffer, for either 16-bit or float samples.
+ */
+typedef union OutPos {
+	int16_t *i16;
+	float *f;
+} OutPos;
+
 /*
  * Run voices for \p time, repeatedly generating up to BUF_LEN samples
- * and writing them into the 16-bit stereo (interleaved) buffer \p buf.
+ * and writing them into the stereo (interleaved) buffer at \p out.
  *
  * \return number of samples generated
  */
 static uint32_t run_for_time(SAU_Interp *restrict o,
-		uint32_t time, int16_t *restrict buf) {
-	int16_t *sp = buf;
+		uint32_t time, OutPos out, bool use_float) {
 	uint32_t gen_len = 0;
 	while (time > 0) {
 		uint32_t len = time;
@@ -385,20 +731,31 @@ static uint32_t run_for_time(SAU_Interp *restrict o,
 					vn->pos += len;
 					break;
 				}
-				sp += wait_time+wait_time; /* stereo double */
+				/* stereo double */
+				if (use_float)
+					out.f += wait_time+wait_time;
+				else
+					out.i16 += wait_time+wait_time;
 				len -= wait_time;
 				gen_len += wait_time;
 				vn->pos = 0;
 			}
 			if (vn->duration != 0) {
-				uint32_t voice_len = run_voice(o, vn, len);
+				uint32_t voice_len = !(vn->flags & VN_DROP) ?
+					run_voice(o, vn, len) :
+					skip_voice(o, vn, len);
 				if (voice_len > last_len) last_len = voice_len;
 			}
 		}
 		time -= len;
 		if (last_len > 0) {
+			uint64_t t = span_start(o);
 			gen_len += last_len;
-			SAU_Mixer_write(o->mixer, &sp, last_len);
+			if (use_float)
+				SAU_Mixer_write_f(o->mixer, &out.f, last_len);
+			else
+				SAU_Mixer_write(o->mixer, &out.i16, last_len);
+			span_add(o, t, SAU_SPAN_MIX, last_len);
 		}
 	}
 	return gen_len;
@@ -417,27 +774,22 @@ static void check_final_state(SAU_Interp *restrict o) {
 	}
 }
 
-/**
- * Main audio generation/processing function. Call repeatedly to write
- * buf_len new samples into the interleaved stereo buffer buf. Any values
- * after the end of the signal will be zero'd.
+/*
+ * Generate \p buf_len samples into zero'd stereo buffer at \p out.
  *
  * \return number of samples generated, buf_len unless signal ended
  */
-size_t SAU_Interp_run(SAU_Interp *restrict o,
-		int16_t *restrict buf, size_t buf_len) {
-	int16_t *sp = buf;
-	uint32_t i, len = buf_len;
-	for (i = len; i--; sp += 2) {
-		sp[0] = 0;
-		sp[1] = 0;
-	}
-	sp = buf;
+static size_t run(SAU_Interp *restrict o,
+		OutPos out, size_t buf_len, bool use_float) {
+	uint32_t len = buf_len;
 	uint32_t skip_len, last_len, gen_len = 0;
 PROCESS:
 	skip_len = 0;
 	while (o->event < o->ev_count) {
-		EventNode *e = o->events[o->event];
+		if (o->event == o->pa.ev_prepared &&
+		    !prepare_events(o, o->event + PREPARE_EVENTS))
+			break;
+		EventNode *e = &o->pa.events[o->event];
 		if (o->event_pos < e->wait) {
 			/*
 			 * Limit voice running len to wait.
@@ -453,14 +805,20 @@ PROCESS:
 			o->event_pos += len;
 			break;
 		}
+		uint64_t t = span_start(o);
 		handle_event(o, e);
+		span_add(o, t, SAU_SPAN_EVENT, o->event);
 		++o->event;
 		o->event_pos = 0;
 	}
-	last_len = run_for_time(o, len, sp);
+	last_len = run_for_time(o, len, out, use_float);
 	if (skip_len > 0) {
 		gen_len += len;
-		sp += len+len; /* stereo double */
+		/* stereo double */
+		if (use_float)
+			out.f += len+len;
+		else
+			out.i16 += len+len;
 		len = skip_len;
 		goto PROCESS;
 	} else {
@@ -476,7 +834,6 @@ PROCESS:
 			/*
 			 * The end.
 			 */
-			check_final_state(o);
 			return gen_len;
 		}
 		vn = &o->voices[o->voice];
@@ -489,6 +846,346 @@ PROCESS:
 	return buf_len;
 }
 
+/*
+ * \return current value of amplitude ramp, approximately
+ */
+static float get_ramp_level(const SAU_Ramp *restrict ramp,
+		uint32_t pos, uint32_t srate) {
+	float v = ramp->v0;
+	if ((ramp->flags & SAU_RAMPP_GOAL) != 0) {
+		uint32_t time = SAU_MS_IN_SAMPLES(ramp->time_ms, srate);
+		if (pos < time)
+			v += (ramp->vt - v) * ((float) pos / time);
+		else
+			v = ramp->vt;
+	}
+	return (v < 0.f) ? -v : v;
+}
+
+/*
+ * \return sum of current carrier amplitudes for voice
+ */
+static float get_voice_level(const SAU_Interp *restrict o,
+		const VoiceNode *restrict vn) {
+	float level = 0.f;
+	for (uint32_t i = 0; i < vn->graph_count; ++i) {
+		const SAU_ProgramOpRef *or = &vn->graph[i];
+		if (or->use != SAU_POP_CARR) continue;
+		const OperatorNode *n = &o->operators[or->id];
+		if (n->time == 0 || (n->flags & ON_MUTE) != 0) continue;
+		float amp = get_ramp_level(&n->amp, n->amp_pos, o->srate);
+		if (n->amods->count > 0) {
+			float amp2 = get_ramp_level(&n->amp2,
+					n->amp2_pos, o->srate);
+			if (amp2 > amp) amp = amp2;
+		}
+		level += amp;
+	}
+	return level;
+}
+
+static int cmp_level(const void *restrict a, const void *restrict b) {
+	float la = ((const VoiceLevel*) a)->level;
+	float lb = ((const VoiceLevel*) b)->level;
+	return (la > lb) - (la < lb);
+}
+
+/*
+ * Mark the \a drop_count quietest voices playing to be dropped
+ * for the next run, and count the voices playing.
+ */
+static void select_drops(SAU_Interp *restrict o) {
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < o->vo_count; ++i) {
+		VoiceNode *vn = &o->voices[i];
+		vn->flags &= ~VN_DROP;
+		if (i < o->voice || !vn->duration || !vn->graph) continue;
+		o->levels[count++] = (VoiceLevel){get_voice_level(o, vn), i};
+	}
+	o->playing = count;
+	uint32_t drops = o->drop_count;
+	if (drops > count) drops = count;
+	if (drops > 0) {
+		qsort(o->levels, count, sizeof(VoiceLevel), cmp_level);
+		for (uint32_t i = 0; i < drops; ++i)
+			o->voices[o->levels[i].id].flags |= VN_DROP;
+	}
+	o->budget_stats.dropped = drops;
+	if (drops > o->budget_stats.max_dropped)
+		o->budget_stats.max_dropped = drops;
+}
+
+/*
+ * Update voices to drop from how long a run of \p buf_len samples
+ * took, in proportion to how far over or under budget it was.
+ */
+static void update_budget(SAU_Interp *restrict o,
+		double secs, size_t buf_len) {
+	SAU_InterpBudgetStats *stats = &o->budget_stats;
+	float load = secs * o->srate / buf_len;
+	float ratio = load / o->budget;
+	++stats->runs;
+	stats->load = load;
+	if (load > stats->max_load)
+		stats->max_load = load;
+	uint32_t kept = o->playing - stats->dropped;
+	if (ratio > 1.f) {
+		++stats->over_runs;
+		uint32_t drops = o->playing - (uint32_t) (kept / ratio);
+		if (drops <= o->drop_count)
+			drops = o->drop_count + 1;
+		if (drops > o->playing)
+			drops = o->playing;
+		o->drop_count = drops;
+	} else if (ratio < BUDGET_RESTORE && o->drop_count > 0) {
+		float more = (kept + 1) * (BUDGET_RESTORE / ratio - 1.f);
+		uint32_t restores = (more < o->drop_count) ?
+			(uint32_t) more : o->drop_count;
+		o->drop_count -= (restores > 0) ? restores : 1;
+	}
+}
+
+/*
+ * Run as with run(), timing the run if in real-time mode
+ * or profiling. In real-time mode, keeps within budget.
+ */
+static size_t run_timed(SAU_Interp *restrict o,
+		OutPos out, size_t buf_len, bool use_float) {
+	bool use_budget = (o->budget > 0.f);
+	if ((!use_budget && !o->prof) || !buf_len)
+		return run(o, out, buf_len, use_float);
+	if (use_budget)
+		select_drops(o);
+	uint64_t start = SAU_time_ns();
+	size_t gen_len = run(o, out, buf_len, use_float);
+	uint64_t ns = SAU_time_ns() - start;
+	if (use_budget)
+		update_budget(o, ns * 1e-9, buf_len);
+	if (o->prof != NULL) {
+		o->prof->ns += ns;
+		o->prof->samples += gen_len;
+	}
+	return gen_len;
+}
+
+/**
+ * Main audio generation/processing function. Call repeatedly to write
+ * buf_len new samples into the interleaved stereo buffer buf. Any values
+ * after the end of the signal will be zero'd.
+ *
+ * \return number of samples generated, buf_len unless signal ended
+ */
+size_t SAU_Interp_run(SAU_Interp *restrict o,
+		int16_t *restrict buf, size_t buf_len) {
+	uint64_t t = span_start(o);
+	int16_t *sp = buf;
+	for (size_t i = buf_len; i--; sp += 2) {
+		sp[0] = 0;
+		sp[1] = 0;
+	}
+	size_t gen_len = run_timed(o, (OutPos){.i16 = buf}, buf_len, false);
+	if (gen_len < buf_len)
+		check_final_state(o);
+	span_add(o, t, SAU_SPAN_RUN, gen_len);
+	return gen_len;
+}
+
+/**
+ * Float version of SAU_Interp_run(), writing \p buf_len new samples
+ * into the interleaved stereo buffer \p buf. Values are not clipped.
+ *
+ * Suitable for use in real-time audio callbacks, with any buffer
+ * length, unless created lazy and not since prepared using
+ * SAU_Interp_prepare(); it then does not allocate memory, lock,
+ * or print anything.
+ *
+ * \return number of samples generated, buf_len unless signal ended
+ */
+size_t SAU_Interp_run_f(SAU_Interp *restrict o,
+		float *restrict buf, size_t buf_len) {
+	uint64_t t = span_start(o);
+	for (size_t i = buf_len * 2; i--; )
+		buf[i] = 0.f;
+	size_t gen_len = run_timed(o, (OutPos){.f = buf}, buf_len, true);
+	span_add(o, t, SAU_SPAN_RUN, gen_len);
+	return gen_len;
+}
+
+/*
+ * State file header. The node sizes are included to reject state
+ * written by an incompatible build; the data is in native layout.
+ */
+#define STATE_MAGIC "SAUS"
+#define STATE_VERSION 1
+
+typedef struct StateHead {
+	char magic[4];
+	uint32_t version;
+	uint32_t vn_size, on_size;
+	uint32_t srate;
+	uint32_t ev_count;
+	uint32_t vo_count;
+	uint32_t op_count;
+	uint32_t duration_ms;
+	uint32_t event;
+	uint32_t event_pos;
+	uint32_t voice;
+} StateHead;
+
+static void init_StateHead(StateHead *restrict h,
+		const SAU_Interp *restrict o) {
+	*h = (StateHead){0};
+	memcpy(h->magic, STATE_MAGIC, sizeof(h->magic));
+	h->version = STATE_VERSION;
+	h->vn_size = sizeof(VoiceNode);
+	h->on_size = sizeof(OperatorNode);
+	h->srate = o->srate;
+	h->ev_count = o->ev_count;
+	h->vo_count = o->vo_count;
+	h->op_count = o->prg->op_count;
+	h->duration_ms = o->prg->duration_ms;
+}
+
+/*
+ * Per-node dynamic state. Pointers (graphs, modulator lists, wave LUTs)
+ * are left out, and recreated by replaying the events already handled.
+ */
+typedef struct VoiceState {
+	int32_t pos;
+	uint32_t duration;
+	uint32_t pan_pos;
+	uint8_t flags;
+	SAU_Ramp pan;
+} VoiceState;
+
+typedef struct OperatorState {
+	uint32_t phase;
+	uint32_t time;
+	uint32_t silence;
+	uint32_t amp_pos, freq_pos;
+	uint32_t amp2_pos, freq2_pos;
+	uint8_t flags;
+	SAU_Ramp amp, freq;
+	SAU_Ramp amp2, freq2;
+} OperatorState;
+
+/**
+ * Write the current state of audio generation to \p f, for later use
+ * with SAU_Interp_restore(). Only valid between SAU_Interp_run() calls.
+ *
+ * \return true unless write failed
+ */
+bool SAU_Interp_save(const SAU_Interp *restrict o, FILE *restrict f) {
+	StateHead h;
+	init_StateHead(&h, o);
+	h.event = o->event;
+	h.event_pos = o->event_pos;
+	h.voice = o->voice;
+	if (fwrite(&h, sizeof(h), 1, f) != 1)
+		return false;
+	for (uint32_t i = 0; i < o->vo_count; ++i) {
+		const VoiceNode *vn = &o->voices[i];
+		VoiceState vs = {0};
+		vs.pos = vn->pos;
+		vs.duration = vn->duration;
+		vs.pan_pos = vn->pan_pos;
+		vs.flags = vn->flags & ~VN_DROP;
+		vs.pan = vn->pan;
+		if (fwrite(&vs, sizeof(vs), 1, f) != 1)
+			return false;
+	}
+	for (uint32_t i = 0; i < o->prg->op_count; ++i) {
+		const OperatorNode *on = &o->operators[i];
+		OperatorState os = {0};
+		os.phase = on->osc.phase;
+		os.time = on->time;
+		os.silence = on->silence;
+		os.amp_pos = on->amp_pos;
+		os.freq_pos = on->freq_pos;
+		os.amp2_pos = on->amp2_pos;
+		os.freq2_pos = on->freq2_pos;
+		os.flags = on->flags;
+		os.amp = on->amp;
+		os.freq = on->freq;
+		os.amp2 = on->amp2;
+		os.freq2 = on->freq2;
+		if (fwrite(&os, sizeof(os), 1, f) != 1)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Read state written by SAU_Interp_save() from \p f, continuing audio
+ * generation from that point. The instance must be newly created, for
+ * the same program and sample rate as the instance the state was saved
+ * from.
+ *
+ * \return true unless read failed or state didn't match
+ */
+bool SAU_Interp_restore(SAU_Interp *restrict o, FILE *restrict f) {
+	StateHead h, cmp;
+	if (o->event != 0 || o->event_pos != 0) {
+		SAU_error("interp", "state restore needs a new instance");
+		return false;
+	}
+	init_StateHead(&cmp, o);
+	if (fread(&h, sizeof(h), 1, f) != 1)
+		goto READ_ERR;
+	cmp.event = h.event;
+	cmp.event_pos = h.event_pos;
+	cmp.voice = h.voice;
+	if (memcmp(&h, &cmp, sizeof(h)) != 0 ||
+			h.event > o->ev_count || h.voice > o->vo_count) {
+		SAU_error("interp", "saved state doesn't match program");
+		return false;
+	}
+	/*
+	 * Replay handled events to set up node references,
+	 * then overwrite all state which changes while running.
+	 */
+	if (!prepare_events(o, h.event))
+		return false;
+	for (uint32_t i = 0; i < h.event; ++i)
+		handle_event(o, &o->pa.events[i]);
+	o->event = h.event;
+	o->event_pos = h.event_pos;
+	o->voice = h.voice;
+	for (uint32_t i = 0; i < o->vo_count; ++i) {
+		VoiceNode *vn = &o->voices[i];
+		VoiceState vs;
+		if (fread(&vs, sizeof(vs), 1, f) != 1)
+			goto READ_ERR;
+		vn->pos = vs.pos;
+		vn->duration = vs.duration;
+		vn->pan_pos = vs.pan_pos;
+		vn->flags = vs.flags;
+		vn->pan = vs.pan;
+	}
+	for (uint32_t i = 0; i < o->prg->op_count; ++i) {
+		OperatorNode *on = &o->operators[i];
+		OperatorState os;
+		if (fread(&os, sizeof(os), 1, f) != 1)
+			goto READ_ERR;
+		on->osc.phase = os.phase;
+		on->time = os.time;
+		on->silence = os.silence;
+		on->amp_pos = os.amp_pos;
+		on->freq_pos = os.freq_pos;
+		on->amp2_pos = os.amp2_pos;
+		on->freq2_pos = os.freq2_pos;
+		on->flags = os.flags;
+		on->amp = os.amp;
+		on->freq = os.freq;
+		on->amp2 = os.amp2;
+		on->freq2 = os.freq2;
+	}
+	return true;
+READ_ERR:
+	SAU_error("interp", "couldn't read saved state");
+	return false;
+}
+
 static void print_graph(const SAU_ProgramOpRef *restrict graph,
 		uint32_t count) {
 	static const char *const uses[SAU_POP_USES] = {
@@ -518,13 +1215,64 @@ static void print_graph(const SAU_ProgramOpRef *restrict graph,
 	putc(']', stdout);
 }
 
+/**
+ * Get memory statistics, for the events prepared so far.
+ */
+void SAU_Interp_get_mem_stats(const SAU_Interp *restrict o,
+		SAU_InterpMemStats *restrict stats) {
+	SAU_MemPool_get_stats(o->mem, &stats->pool);
+	stats->max_bufs = o->pa.max_bufs;
+	stats->buf_count = o->buf_count;
+	stats->buf_size = sizeof(Buf);
+	stats->mix_size = SAU_MIX_BUFLEN * sizeof(float) * 3;
+}
+
+/**
+ * Get real-time budget statistics, for the runs so far
+ * since SAU_Interp_set_budget().
+ */
+void SAU_Interp_get_budget_stats(const SAU_Interp *restrict o,
+		SAU_InterpBudgetStats *restrict stats) {
+	*stats = o->budget_stats;
+}
+
+/**
+ * Get profile for the runs so far, if enabled.
+ *
+ * \return profile, or NULL if not profiling
+ */
+const SAU_InterpProfile *SAU_Interp_get_profile(
+		const SAU_Interp *restrict o) {
+	return o->prof;
+}
+
+/**
+ * Get spans recorded since last taken, if enabled. The caller is
+ * to reset \a count after taking them, between runs.
+ *
+ * \return trace, or NULL if not tracing
+ */
+SAU_InterpTrace *SAU_Interp_get_trace(SAU_Interp *restrict o) {
+	return o->trace;
+}
+
 /**
  * Print information about contents to be interpreted.
+ * Prepares all events.
+ *
+ * \return true, or false on allocation failure or invalid data
  */
-void SAU_Interp_print(const SAU_Interp *restrict o) {
+bool SAU_Interp_print(SAU_Interp *restrict o) {
+	if (!SAU_Interp_prepare(o))
+		return false;
 	SAU_Program_print_info(o->prg, "Program: \"", "\"");
+	fprintf(stdout,
+		"\tGraphs:   \t%d unique of %d (%.1f:1)\n",
+		o->pa.graph_count, o->pa.graph_uses,
+		(double) o->pa.graph_uses /
+		((o->pa.graph_count > 0) ? o->pa.graph_count : 1));
 	for (size_t ev_id = 0; ev_id < o->ev_count; ++ev_id) {
-		const EventNode *ev = o->events[ev_id];
+		const EventNode *ev = &o->pa.events[ev_id];
 		const SAU_ProgramEvent *prg_ev = ev->prg_e;
 		const SAU_ProgramVoData *prg_vd = prg_ev->vo_data;
 		fprintf(stdout,
@@ -538,4 +1286,5 @@ void SAU_Interp_print(const SAU_Interp *restrict o) {
 		SAU_ProgramEvent_print_operators(prg_ev);
 		putc('\n', stdout);
 	}
+	return true;
 }
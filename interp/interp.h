@@ -13,15 +13,133 @@
 
 #pragma once
 #include "../program.h"
+#include "../mempool.h"
+#include <stdio.h>
 
 struct SAU_Interp;
 typedef struct SAU_Interp SAU_Interp;
 
+/**
+ * Memory statistics for an interpreter instance.
+ */
+typedef struct SAU_InterpMemStats {
+	SAU_MemPoolStats pool;
+	uint32_t max_bufs;  // scratch buffers needed for voice graphs
+	uint32_t buf_count; // scratch buffers allocated in pool
+	size_t buf_size;    // bytes per scratch buffer
+	size_t mix_size;    // bytes for mixing, outside pool
+} SAU_InterpMemStats;
+
+/**
+ * Real-time budget statistics for an interpreter instance;
+ * see SAU_Interp_set_budget().
+ */
+typedef struct SAU_InterpBudgetStats {
+	uint32_t runs;        // runs timed
+	uint32_t over_runs;   // runs taking longer than budget
+	uint32_t dropped;     // voices dropped for latest run
+	uint32_t max_dropped; // most voices dropped for a run
+	float load;           // run time per audio time, latest run
+	float max_load;
+} SAU_InterpBudgetStats;
+
+/**
+ * Kernel types timed when profiling.
+ */
+enum {
+	SAU_PROF_OSC = 0, // oscillator sample generation
+	SAU_PROF_RAMP,    // parameter value fills
+	SAU_PROF_COMBINE, // FM and AM combining loops
+	SAU_PROF_MIX,     // panning and mixing of voice output
+	SAU_PROF_KERNELS
+};
+
+/**
+ * Profile data per operator. Time is that of the kernels run for
+ * the operator itself, not including its modulators.
+ */
+typedef struct SAU_InterpOpProfile {
+	uint64_t ns;
+	uint64_t samples; // generated, not counting silence or muting
+	uint8_t wave;     // latest wave type set
+	uint8_t uses;     // bits for each SAU_POP_* use in voice graphs
+} SAU_InterpOpProfile;
+
+/**
+ * Profile data per voice. Time includes all operators and mixing.
+ */
+typedef struct SAU_InterpVoiceProfile {
+	uint64_t ns;
+	uint64_t samples;
+} SAU_InterpVoiceProfile;
+
+/**
+ * Profile for an interpreter instance; see SAU_Interp_set_profile().
+ */
+typedef struct SAU_InterpProfile {
+	SAU_InterpOpProfile *ops;
+	SAU_InterpVoiceProfile *voices;
+	uint32_t op_count;
+	uint32_t vo_count;
+	uint64_t kernel_ns[SAU_PROF_KERNELS];
+	uint64_t kernel_samples[SAU_PROF_KERNELS];
+	uint64_t ns;      // total time running
+	uint64_t samples; // total output length
+} SAU_InterpProfile;
+
+/**
+ * Kinds of spans recorded when tracing.
+ */
+enum {
+	SAU_SPAN_RUN = 0, // a run call; n is samples generated
+	SAU_SPAN_PREPARE, // events prepared; n is events
+	SAU_SPAN_EVENT,   // an event handled; n is its ID
+	SAU_SPAN_MIX,     // a mixer write; n is samples
+	SAU_SPAN_KINDS
+};
+
+/**
+ * Timed span, with times in nanoseconds on the monotonic clock.
+ */
+typedef struct SAU_InterpSpan {
+	uint64_t start, end;
+	uint32_t n;
+	uint32_t kind;
+} SAU_InterpSpan;
+
+/**
+ * Spans recorded for an interpreter instance, to be taken between
+ * runs, resetting \a count; see SAU_Interp_set_trace().
+ */
+typedef struct SAU_InterpTrace {
+	SAU_InterpSpan *spans;
+	uint32_t count;
+	uint32_t max;
+	uint32_t dropped; // not recorded for lack of room
+} SAU_InterpTrace;
+
 SAU_Interp* SAU_create_Interp(const SAU_Program *restrict prg,
-		uint32_t srate) sauMalloclike;
+		uint32_t srate, bool lazy) sauMalloclike;
 void SAU_destroy_Interp(SAU_Interp *restrict o);
 
+bool SAU_Interp_prepare(SAU_Interp *restrict o);
+bool SAU_Interp_set_budget(SAU_Interp *restrict o, float max_load);
+bool SAU_Interp_set_profile(SAU_Interp *restrict o, bool enable);
+bool SAU_Interp_set_trace(SAU_Interp *restrict o, uint32_t max_spans);
+
 size_t SAU_Interp_run(SAU_Interp *restrict o,
 		int16_t *restrict buf, size_t buf_len);
+size_t SAU_Interp_run_f(SAU_Interp *restrict o,
+		float *restrict buf, size_t buf_len);
+
+bool SAU_Interp_save(const SAU_Interp *restrict o, FILE *restrict f);
+bool SAU_Interp_restore(SAU_Interp *restrict o, FILE *restrict f);
 
-void SAU_Interp_print(const SAU_Interp *restrict o);
+bool SAU_Interp_print(SAU_Interp *restrict o);
+void SAU_Interp_get_mem_stats(const SAU_Interp *restrict o,
+		SAU_InterpMemStats *restrict stats);
+void SAU_Interp_get_budget_stats(const SAU_Interp *restrict o,
+		SAU_InterpBudgetStats *restrict stats);
+const SAU_InterpProfile *SAU_Interp_get_profile(
+		const SAU_Interp *restrict o);
+SAU_InterpTrace *SAU_Interp_get_trace(SAU_Interp *restrict o);
@@ -102,3 +102,18 @@ void SAU_Mixer_write(SAU_Mixer *restrict o,
 		*(*spp)++ += lrintf(s_r * (float) INT16_MAX);
 	}
 }
+
+/**
+ * Write \p len samples from the mix buffers
+ * into a float stereo (interleaved) buffer
+ * pointed to by \p spp. Advances \p spp.
+ *
+ * Unlike for SAU_Mixer_write(), values are not clipped.
+ */
+void SAU_Mixer_write_f(SAU_Mixer *restrict o,
+		float **restrict spp, size_t len) {
+	for (size_t i = 0; i < len; ++i) {
+		*(*spp)++ += o->mix_l[i];
+		*(*spp)++ += o->mix_r[i];
+	}
+}
@@ -46,3 +46,5 @@ void SAU_Mixer_add(SAU_Mixer *restrict o,
 		SAU_Ramp *restrict pan, uint32_t *restrict pan_pos);
 void SAU_Mixer_write(SAU_Mixer *restrict o,
 		int16_t **restrict spp, size_t len);
+void SAU_Mixer_write_f(SAU_Mixer *restrict o,
+		float **restrict spp, size_t len);
@@ -12,7 +12,9 @@
  */
 
 #include "prealloc.h"
+#include "../reader/symtab.h"
 #include <stdio.h>
+#include <string.h>
 
 /*
  * Voice graph traverser and data allocator.
@@ -28,7 +30,10 @@ static bool traverse_op_node(SAU_PreAlloc *restrict o,
  */
 static bool traverse_op_list(SAU_PreAlloc *restrict o,
 		const SAU_ProgramOpList *restrict op_list, uint8_t mod_use) {
-	SAU_ProgramOpRef op_ref = {0, mod_use, o->vg.nest_level};
+	SAU_ProgramOpRef op_ref;
+	memset(&op_ref, 0, sizeof(op_ref)); /* graphs are compared bytewise */
+	op_ref.use = mod_use;
+	op_ref.level = o->vg.nest_level;
 	for (uint32_t i = 0; i < op_list->count; ++i) {
 		op_ref.id = op_list->ids[i];
 		if (!traverse_op_node(o, &op_ref))
@@ -45,7 +50,7 @@ static bool traverse_op_list(SAU_PreAlloc *restrict o,
  */
 static bool traverse_op_node(SAU_PreAlloc *restrict o,
 		SAU_ProgramOpRef *restrict op_ref) {
-	OperatorNode *on = &o->operators[op_ref->id];
+	OpLinks *on = &o->op_links[op_ref->id];
 	if (on->flags & ON_VISITED) {
 		SAU_warning("voicegraph",
 "skipping operator %d; circular references unsupported",
@@ -75,6 +80,8 @@ static bool traverse_op_node(SAU_PreAlloc *restrict o,
  * during allocation, assigning an operator reference
  * list to the voice and block IDs to the operators.
  *
+ * Identical graphs share storage.
+ *
  * \return true, or false on allocation failure
  */
 static bool set_voice_graph(SAU_PreAlloc *restrict o,
@@ -83,9 +90,17 @@ static bool set_voice_graph(SAU_PreAlloc *restrict o,
 	if (!pvd->carriers->count) goto DONE;
 	if (!traverse_op_list(o, pvd->carriers, SAU_POP_CARR))
 		return false;
-	if (!SAU_OpRefArr_mpmemdup(&o->vg.vo_graph,
-				(SAU_ProgramOpRef**) &ev->graph, o->mem))
+	SAU_SymStr *item = SAU_SymTab_get_symstr(o->vg.graphs,
+			o->vg.vo_graph.a,
+			sizeof(SAU_ProgramOpRef) * o->vg.vo_graph.count);
+	if (!item)
 		return false;
+	++o->graph_uses;
+	if (!item->data) {
+		item->data = item; /* mark as counted */
+		++o->graph_count;
+	}
+	ev->graph = (const SAU_ProgramOpRef*) item->key;
 	ev->graph_count = o->vg.vo_graph.count;
 DONE:
 	o->vg.vo_graph.count = 0; // re-use allocation
@@ -106,41 +121,20 @@ static void init_operators(SAU_PreAlloc *restrict o) {
 	}
 }
 
-static bool init_events(SAU_PreAlloc *restrict o) {
+/*
+ * Set the initial wait for voices, which depends on all events.
+ */
+static void init_voices(SAU_PreAlloc *restrict o) {
 	const SAU_Program *prg = o->prg;
 	uint32_t vo_wait_time = 0;
 	for (size_t i = 0; i < prg->ev_count; ++i) {
-		const SAU_ProgramEvent *prg_e = prg->events[i];
-		EventNode *e = SAU_MemPool_alloc(o->mem, sizeof(EventNode));
-		if (!e)
-			return false;
-		uint16_t vo_id = prg_e->vo_id;
-		e->wait = SAU_MS_IN_SAMPLES(prg_e->wait_ms, o->srate);
-		vo_wait_time += e->wait;
-		e->prg_e = prg_e;
-		for (size_t i = 0; i < prg_e->op_data_count; ++i) {
-			const SAU_ProgramOpData *od = &prg_e->op_data[i];
-			OperatorNode *on = &o->operators[od->id];
-			/*
-			 * Apply linkage updates for use in init traversal.
-			 */
-			on->fmods = od->fmods;
-			on->pmods = od->pmods;
-			on->amods = od->amods;
-		}
+		const SAU_ProgramEvent *prg_e = &prg->events[i];
+		vo_wait_time += SAU_MS_IN_SAMPLES(prg_e->wait_ms, o->srate);
 		if (prg_e->vo_data) {
-			const SAU_ProgramVoData *pvd = prg_e->vo_data;
-			uint32_t params = pvd->params;
-			if (params & SAU_PVOP_GRAPH) {
-				if (!set_voice_graph(o, pvd, e))
-					return false;
-			}
-			o->voices[vo_id].pos = -vo_wait_time;
+			o->voices[prg_e->vo_id].pos = -vo_wait_time;
 			vo_wait_time = 0;
 		}
-		o->events[i] = e;
 	}
-	return true;
 }
 
 /*
@@ -159,11 +153,16 @@ static bool check_validity(SAU_PreAlloc *restrict o) {
 	return !error;
 }
 
+/**
+ * Fill in nodes for program, without preparing events.
+ * Only the initial voice waits depend on the length of the program.
+ *
+ * \return true, or false on allocation failure
+ */
 bool SAU_fill_PreAlloc(SAU_PreAlloc *restrict o,
 		const SAU_Program *restrict prg, uint32_t srate,
 		SAU_MemPool *restrict mem) {
 	size_t i;
-	bool error = false;
 	*o = (SAU_PreAlloc){0};
 	o->prg = prg;
 	o->srate = srate;
@@ -171,7 +170,7 @@ bool SAU_fill_PreAlloc(SAU_PreAlloc *restrict o,
 	i = prg->ev_count;
 	if (i > 0) {
 		o->events = SAU_MemPool_alloc(o->mem,
-				i * sizeof(EventNode*));
+				i * sizeof(EventNode));
 		if (!o->events) goto MEM_ERR;
 		o->ev_count = i;
 	}
@@ -180,6 +179,9 @@ bool SAU_fill_PreAlloc(SAU_PreAlloc *restrict o,
 		o->operators = SAU_MemPool_alloc(o->mem,
 				i * sizeof(OperatorNode));
 		if (!o->operators) goto MEM_ERR;
+		o->op_links = SAU_MemPool_alloc(o->mem,
+				i * sizeof(OpLinks));
+		if (!o->op_links) goto MEM_ERR;
 		o->op_count = i;
 	}
 	i = prg->vo_count;
@@ -189,18 +191,69 @@ bool SAU_fill_PreAlloc(SAU_PreAlloc *restrict o,
 		if (!o->voices) goto MEM_ERR;
 		o->vo_count = i;
 	}
+	o->vg.graphs = SAU_create_SymTab(o->mem);
+	if (!o->vg.graphs) goto MEM_ERR;
 
 	init_operators(o);
-	if (!init_events(o)) goto MEM_ERR;
-	if (!check_validity(o)) {
-		error = true;
+	init_voices(o);
+	o->max_bufs = COUNT_BUFS(0);
+	return true;
+MEM_ERR:
+	SAU_error("prealloc", "memory allocation failure");
+	return false;
+}
+
+/**
+ * Prepare events up to, not including, \p ev_end, continuing after
+ * those already prepared. Updates \a max_bufs for the voice graphs.
+ *
+ * On failure, later events are not to be used.
+ *
+ * \return true, or false on allocation failure or invalid data
+ */
+bool SAU_PreAlloc_prepare(SAU_PreAlloc *restrict o, size_t ev_end) {
+	const SAU_Program *prg = o->prg;
+	if (ev_end > o->ev_count)
+		ev_end = o->ev_count;
+	for (size_t i = o->ev_prepared; i < ev_end; ++i) {
+		const SAU_ProgramEvent *prg_e = &prg->events[i];
+		EventNode *e = &o->events[i];
+		e->wait = SAU_MS_IN_SAMPLES(prg_e->wait_ms, o->srate);
+		e->prg_e = prg_e;
+		const SAU_ProgramOpData *od = prg_e->op_data;
+		for (size_t i = 0; i < prg_e->op_data_count;
+				++i, od = SAU_ProgramOpData_next(od)) {
+			OpLinks *on = &o->op_links[od->id];
+			/*
+			 * Apply linkage updates for use in init traversal.
+			 */
+			on->fmods = od->fmods;
+			on->pmods = od->pmods;
+			on->amods = od->amods;
+		}
+		if (prg_e->vo_data) {
+			const SAU_ProgramVoData *pvd = prg_e->vo_data;
+			uint32_t params = pvd->params;
+			if (params & SAU_PVOP_GRAPH) {
+				if (!set_voice_graph(o, pvd, e)) goto MEM_ERR;
+			}
+		}
+		o->ev_prepared = i + 1;
 	}
+	if (!check_validity(o))
+		return false;
 	o->max_bufs = COUNT_BUFS(o->vg.nest_max);
-	if (false)
-	MEM_ERR: {
-		SAU_error("prealloc", "memory allocation failure");
-		error = true;
-	}
+	return true;
+MEM_ERR:
+	SAU_error("prealloc", "memory allocation failure");
+	return false;
+}
+
+/**
+ * Free data only used for preparing events.
+ */
+void SAU_fini_PreAlloc(SAU_PreAlloc *restrict o) {
 	SAU_OpRefArr_clear(&o->vg.vo_graph);
-	return !error;
+	SAU_destroy_SymTab(o->vg.graphs);
+	o->vg.graphs = NULL;
 }
@@ -23,6 +23,7 @@
 enum {
 	ON_VISITED = 1<<0,
 	ON_TIME_INF = 1<<1, /* used for SAU_TIMEP_LINKED */
+	ON_MUTE = 1<<2, /* output zero, subnodes not run */
 };
 
 typedef struct OperatorNode {
@@ -44,6 +45,7 @@ typedef struct OperatorNode {
  */
 enum {
 	VN_INIT = 1<<0,
+	VN_DROP = 1<<1, /* skipped to keep within real-time budget */
 };
 
 typedef struct VoiceNode {
@@ -65,6 +67,17 @@ typedef struct EventNode {
 
 sauArrType(SAU_OpRefArr, SAU_ProgramOpRef, )
 
+/*
+ * Operator linkage as of the latest event prepared,
+ * kept apart from the operator nodes used while running.
+ */
+typedef struct OpLinks {
+	const SAU_ProgramOpList *fmods;
+	const SAU_ProgramOpList *pmods;
+	const SAU_ProgramOpList *amods;
+	uint8_t flags;
+} OpLinks;
+
 /*
  * Voice data per event during pre-allocation pass.
  */
@@ -72,21 +85,27 @@ typedef struct SAU_VoiceGraph {
 	SAU_OpRefArr vo_graph;
 	uint32_t nest_level;
 	uint32_t nest_max; // for all traversals
+	struct SAU_SymTab *graphs; // for sharing identical graphs
 } SAU_VoiceGraph;
 
 /*
- * Pre-allocation data. For copying from after filled.
+ * Pre-allocation data. Nodes are allocated when filled, while
+ * events are prepared incrementally; see SAU_PreAlloc_prepare().
  */
 typedef struct SAU_PreAlloc {
 	const SAU_Program *prg;
 	uint32_t srate;
 	size_t ev_count;
+	size_t ev_prepared;
 	uint32_t op_count;
 	uint16_t vo_count;
 	uint16_t max_bufs;
-	EventNode **events;
+	uint32_t graph_count; // unique graphs stored
+	uint32_t graph_uses; // graphs assigned, sharing storage
+	EventNode *events;
 	VoiceNode *voices;
 	OperatorNode *operators;
+	OpLinks *op_links;
 	SAU_MemPool *mem;
 	SAU_VoiceGraph vg;
 } SAU_PreAlloc;
@@ -94,3 +113,5 @@ typedef struct SAU_PreAlloc {
 bool SAU_fill_PreAlloc(SAU_PreAlloc *restrict o,
 		const SAU_Program *restrict prg, uint32_t srate,
 		SAU_MemPool *restrict mem);
+bool SAU_PreAlloc_prepare(SAU_PreAlloc *restrict o, size_t ev_end);
+void SAU_fini_PreAlloc(SAU_PreAlloc *restrict o);
@@ -0,0 +1,46 @@
+/* saugns: Library interface.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "program.h"
+#include "interp/interp.h"
+
+/*
+ * Use of libsaugns (built using `make lib`) for embedding:
+ *
+ *  - SAU_load_Program() builds a program from a script file or string.
+ *    A program is read-only after it's built, and may be shared by any
+ *    number of interpreters, also in different threads. It's destroyed
+ *    using SAU_discard_Program() after its interpreters are destroyed.
+ *
+ *  - SAU_create_Interp() creates an independent interpreter for a
+ *    program and sample rate, and SAU_destroy_Interp() destroys it.
+ *    All events are prepared on creation, which fails for invalid
+ *    data. If created lazy, events are instead prepared a little at
+ *    a time while running, and invalid data ends the signal early,
+ *    unless SAU_Interp_prepare() is called to prepare all of them first.
+ *    The program is not streamed, and is kept whole while used.
+ *
+ *  - SAU_Interp_run_f() renders any number of stereo float frames,
+ *    and can be called from a real-time audio thread unless running
+ *    lazily; it does not allocate memory, lock, or print anything.
+ *    SAU_Interp_run() is the 16-bit version used by the command-line
+ *    player.
+ *
+ * Each interpreter is to be used by one thread at a time.
+ *
+ * Memory pools released by programs and interpreters are kept for
+ * reuse in the thread which destroyed them. A thread which has done
+ * so should call SAU_clear_MemPool_cache() before it exits, to free
+ * them.
+ */
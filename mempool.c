@@ -29,11 +29,22 @@
 
 #define DEFAULT_START_SIZE 2048
 
+/*
+ * Limits for pools kept per thread for reuse. Without thread-local
+ * storage, none are kept, as the cache would be shared unlocked.
+ */
+#if SAU_HAVE_THREAD_LOCAL
+# define CACHE_MAX      8
+#else
+# define CACHE_MAX      0
+#endif
+#define CACHE_MAX_BYTES (4 * 1024 * 1024)
+
 #define ALIGN_BYTES      sizeof(void*)
 #define ALIGN_SIZE(size) (((size) + (ALIGN_BYTES - 1)) & ~(ALIGN_BYTES - 1))
 
 typedef struct MemBlock {
-	size_t free;
+	size_t free, size;
 	char *mem;
 } MemBlock;
 
@@ -41,8 +52,19 @@ struct SAU_MemPool {
 	MemBlock *a;
 	size_t count, first_i, alloc_len;
 	size_t block_size, skip_size;
+	size_t mem_size, requested, used;
 };
 
+/*
+ * Reset pools released for reuse in the current thread.
+ */
+#if SAU_HAVE_THREAD_LOCAL
+static sauThreadLocal SAU_MemPool *cache[CACHE_MAX];
+#else
+static SAU_MemPool **const cache = NULL;
+#endif
+static sauThreadLocal size_t cache_count;
+
 /*
  * Extend memory block array.
  *
@@ -89,7 +111,9 @@ static void *add(SAU_MemPool *restrict o, size_t size_used) {
 		return NULL;
 	size_t i = o->count++;
 	o->a[i].free = block_size - size_used;
+	o->a[i].size = block_size;
 	o->a[i].mem = mem;
+	o->mem_size += block_size;
 	/*
 	 * Skip fully used blocks in binary searches.
 	 */
@@ -212,6 +236,104 @@ void SAU_destroy_MemPool(SAU_MemPool *restrict o) {
 	free(o);
 }
 
+/**
+ * Rewind the pool, making all memory free for new allocations
+ * while keeping the blocks. Used memory is zeroed, as is needed
+ * for allocations; the cost follows the memory used rather than
+ * that held.
+ *
+ * All memory previously allocated from the pool becomes invalid.
+ */
+void SAU_MemPool_reset(SAU_MemPool *restrict o) {
+#if !SAU_MEM_DEBUG
+	for (size_t i = 0; i < o->count; ++i) {
+		MemBlock *b = &o->a[i];
+		memset(b->mem + b->free, 0, b->size - b->free);
+		b->free = b->size;
+	}
+	/*
+	 * Re-sort by free space, now the block sizes. There are
+	 * few blocks, as sizes grow with the count.
+	 */
+	for (size_t i = 1; i < o->count; ++i) {
+		MemBlock tmp = o->a[i];
+		size_t j = i;
+		for (; j > 0 && o->a[j - 1].free > tmp.free; --j)
+			o->a[j] = o->a[j - 1];
+		o->a[j] = tmp;
+	}
+	o->first_i = 0;
+#else /* SAU_MEM_DEBUG */
+	for (size_t i = 0; i < o->count; ++i) {
+		free(o->a[i].mem);
+	}
+	o->count = 0;
+	o->mem_size = 0;
+#endif
+	o->requested = 0;
+	o->used = 0;
+}
+
+/**
+ * Get statistics for the pool. Waste is the free space left in
+ * blocks counted as fully used, skipped when allocating; padding
+ * for alignment is the difference between used and requested.
+ */
+void SAU_MemPool_get_stats(const SAU_MemPool *restrict o,
+		SAU_MemPoolStats *restrict stats) {
+	stats->requested = o->requested;
+	stats->used = o->used;
+	stats->reserved = o->mem_size;
+	stats->blocks = o->count;
+	stats->waste = 0;
+#if !SAU_MEM_DEBUG
+	for (size_t i = 0; i < o->first_i; ++i)
+		stats->waste += o->a[i].free;
+#endif
+}
+
+/**
+ * Get a pool for use, reusing one released in the current thread
+ * if available, otherwise creating it using \p start_size. Pair
+ * with SAU_release_MemPool() rather than SAU_destroy_MemPool().
+ *
+ * Repeated use then reaches a steady state without allocation,
+ * as long as the sizes of pools used stay within cache limits.
+ *
+ * \return instance, or NULL on allocation failure
+ */
+SAU_MemPool *SAU_obtain_MemPool(size_t start_size) {
+	if (cache_count > 0)
+		return cache[--cache_count];
+	return SAU_create_MemPool(start_size);
+}
+
+/**
+ * Release pool obtained using SAU_obtain_MemPool(). It is reset
+ * and kept for reuse in the current thread, unless too many are
+ * kept or it holds too much memory, in which case it's destroyed.
+ */
+void SAU_release_MemPool(SAU_MemPool *restrict o) {
+	if (!o)
+		return;
+	if (cache_count == CACHE_MAX || o->mem_size > CACHE_MAX_BYTES) {
+		SAU_destroy_MemPool(o);
+		return;
+	}
+	SAU_MemPool_reset(o);
+	cache[cache_count++] = o;
+}
+
+/**
+ * Destroy the pools kept for reuse in the current thread. To be
+ * called by a thread which has used SAU_release_MemPool() before
+ * it exits, as the pools are otherwise not freed.
+ */
+void SAU_clear_MemPool_cache(void) {
+	while (cache_count > 0)
+		SAU_destroy_MemPool(cache[--cache_count]);
+}
+
 /**
  * Allocate block of \p size within the memory pool,
  * initialized to zero bytes.
@@ -221,6 +343,7 @@ void SAU_destroy_MemPool(SAU_MemPool *restrict o) {
 void *SAU_MemPool_alloc(SAU_MemPool *restrict o, size_t size) {
 #if !SAU_MEM_DEBUG
 	size_t i = o->count;
+	size_t req_size = size;
 	void *mem;
 	size = ALIGN_SIZE(size);
 	/*
@@ -262,6 +385,8 @@ void *SAU_MemPool_alloc(SAU_MemPool *restrict o, size_t size) {
 			o->a[i].free = i_free;
 		}
 	}
+	o->requested += req_size;
+	o->used += size;
 	return mem;
 #else /* SAU_MEM_DEBUG */
 	if (o->count == o->alloc_len && !upsize(o))
@@ -270,6 +395,9 @@ void *SAU_MemPool_alloc(SAU_MemPool *restrict o, size_t size) {
 	if (!mem)
 		return NULL;
 	o->a[o->count++].mem = mem;
+	o->mem_size += size;
+	o->requested += size;
+	o->used += size;
 	return mem;
 #endif
 }
@@ -21,8 +21,26 @@
 struct SAU_MemPool;
 typedef struct SAU_MemPool SAU_MemPool;
 
+/**
+ * Statistics for a memory pool, counted since creation or reset.
+ */
+typedef struct SAU_MemPoolStats {
+	size_t requested; // bytes asked for
+	size_t used;      // bytes handed out, including alignment
+	size_t reserved;  // bytes held in blocks
+	size_t blocks;    // number of blocks
+	size_t waste;     // bytes free in blocks no longer searched
+} SAU_MemPoolStats;
+
 SAU_MemPool *SAU_create_MemPool(size_t start_size) sauMalloclike;
 void SAU_destroy_MemPool(SAU_MemPool *restrict o);
+void SAU_MemPool_reset(SAU_MemPool *restrict o);
+void SAU_MemPool_get_stats(const SAU_MemPool *restrict o,
+		SAU_MemPoolStats *restrict stats);
+
+SAU_MemPool *SAU_obtain_MemPool(size_t start_size) sauMalloclike;
+void SAU_release_MemPool(SAU_MemPool *restrict o);
+void SAU_clear_MemPool_cache(void);
 
 void *SAU_MemPool_alloc(SAU_MemPool *restrict o, size_t size) sauMalloclike;
 void *SAU_MemPool_memdup(SAU_MemPool *restrict o,
@@ -44,6 +44,7 @@ struct SAU_AudioDev {
 	uint8_t type;
 	uint16_t channels;
 	uint32_t srate;
+	SAU_AudioDevStats stats;
 };
 
 #define SOUND_BITS 16
@@ -121,3 +122,11 @@ bool SAU_AudioDev_write(SAU_AudioDev *restrict o,
 	return oss_write(o, buf, samples);
 #endif
 }
+
+/**
+ * Get underrun and error counts since the audio device was opened.
+ */
+void SAU_AudioDev_get_stats(const SAU_AudioDev *restrict o,
+		SAU_AudioDevStats *restrict stats) {
+	*stats = o->stats;
+}
@@ -21,6 +21,17 @@
 struct SAU_AudioDev;
 typedef struct SAU_AudioDev SAU_AudioDev;
 
+/**
+ * Statistics for an audio device, counted since opened.
+ * Underruns are counted where the system reports them
+ * (ALSA, and OSS versions supporting SNDCTL_DSP_GETERROR).
+ */
+typedef struct SAU_AudioDevStats {
+	uint32_t xruns;      // buffer underruns
+	uint32_t recoveries; // underruns recovered from
+	uint32_t errors;     // failed writes
+} SAU_AudioDevStats;
+
 SAU_AudioDev *SAU_open_AudioDev(uint16_t channels, uint32_t *restrict srate)
 	sauMalloclike;
 void SAU_close_AudioDev(SAU_AudioDev *restrict o);
@@ -28,3 +39,5 @@ void SAU_close_AudioDev(SAU_AudioDev *restrict o);
 uint32_t SAU_AudioDev_get_srate(const SAU_AudioDev *restrict o);
 bool SAU_AudioDev_write(SAU_AudioDev *restrict o,
 		const int16_t *restrict buf, uint32_t samples);
+void SAU_AudioDev_get_stats(const SAU_AudioDev *restrict o,
+		SAU_AudioDevStats *restrict stats);
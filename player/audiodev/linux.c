@@ -69,6 +69,7 @@ static inline SAU_AudioDev *open_linux(const char *restrict alsa_name,
 	o->type = TYPE_ALSA;
 	o->channels = channels;
 	o->srate = *srate;
+	o->stats = (SAU_AudioDevStats){0};
 	return o;
 
 ERROR:
@@ -108,13 +109,23 @@ static inline bool linux_write(SAU_AudioDev *restrict o,
 	snd_pcm_sframes_t written;
 	while ((written = snd_pcm_writei(o->ref.handle, buf, samples)) < 0) {
 		if (written == -EPIPE) {
+			int err;
 			SAU_warning("ALSA", "audio device buffer underrun");
-			snd_pcm_prepare(o->ref.handle);
+			++o->stats.xruns;
+			if ((err = snd_pcm_prepare(o->ref.handle)) < 0) {
+				SAU_warning("ALSA", "%s", snd_strerror(err));
+				break;
+			}
+			++o->stats.recoveries;
 		} else {
 			SAU_warning("ALSA", "%s", snd_strerror(written));
 			break;
 		}
 	}
 
-	return (written == (snd_pcm_sframes_t) samples);
+	if (written != (snd_pcm_sframes_t) samples) {
+		++o->stats.errors;
+		return false;
+	}
+	return true;
 }
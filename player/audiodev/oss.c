@@ -76,6 +76,7 @@ static inline SAU_AudioDev *open_oss(const char *restrict name, int mode,
 	o->type = TYPE_OSS;
 	o->channels = channels;
 	o->srate = *srate;
+	o->stats = (SAU_AudioDevStats){0};
 	return o;
 
 ERROR:
@@ -106,6 +107,19 @@ static inline bool oss_write(SAU_AudioDev *restrict o,
 		const int16_t *restrict buf, uint32_t samples) {
 	size_t length = samples * o->channels * SOUND_BYTES;
 	size_t written = write(o->ref.fd, buf, length);
+#ifdef SNDCTL_DSP_GETERROR
+	audio_errinfo ei;
+	if (ioctl(o->ref.fd, SNDCTL_DSP_GETERROR, &ei) != -1 &&
+	    ei.play_underruns > 0) {
+		/* recovered from by the driver */
+		o->stats.xruns += ei.play_underruns;
+		o->stats.recoveries += ei.play_underruns;
+	}
+#endif
 
-	return (written == length);
+	if (written != length) {
+		++o->stats.errors;
+		return false;
+	}
+	return true;
 }
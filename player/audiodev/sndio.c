@@ -52,6 +52,7 @@ static inline SAU_AudioDev *open_sndio(const char *restrict name,
 	o->type = TYPE_SNDIO;
 	o->channels = channels;
 	o->srate = *srate;
+	o->stats = (SAU_AudioDevStats){0};
 	return o;
 
 ERROR:
@@ -80,5 +81,9 @@ static inline bool sndio_write(SAU_AudioDev *restrict o,
 	size_t wlen;
 
 	wlen = sio_write(o->ref.handle, buf, bytes);
-	return (wlen == bytes);
+	if (wlen != bytes) {
+		++o->stats.errors;
+		return false;
+	}
+	return true;
 }
@@ -13,15 +13,49 @@
 
 #include "../saugns.h"
 #include "../interp/interp.h"
+#include "../interp/cost.h"
+#include "../trace.h"
 #include "audiodev.h"
 #include "wavfile.h"
 #include "../time.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define BUF_TIME_MS  256
 #define CH_MIN_LEN   1
 #define NUM_CHANNELS 2
 
+#define PROF_TOP_OPS    10
+#define PROF_TOP_VOICES 5
+
+#define LOAD_BINS 400 /* of 0.5% each, the last for any above */
+
+#define TRACE_SPANS 4096 /* recorded by interpreter per run */
+
+#define CKPT_MAGIC "SAUC"
+#define CKPT_EXT ".ckpt"
+#define CKPT_TMP_EXT ".ckpt.tmp"
+
+typedef struct CkptHead {
+	char magic[4];
+	uint32_t prg_i;
+	uint32_t wf_samples;
+} CkptHead;
+
+/*
+ * Real-time statistics for audio device output. Each period is that
+ * of generating and writing one buffer; its load is the time taken
+ * generating per time played, and the headroom what's left.
+ */
+typedef struct PlayStats {
+	uint32_t periods;
+	uint64_t samples;
+	double min_headroom, sum_headroom;
+	SAU_AudioDevStats dev; // at start
+	uint32_t load_bins[LOAD_BINS];
+} PlayStats;
+
 typedef struct SAU_Output {
 	SAU_AudioDev *ad;
 	SAU_WAVFile *wf;
@@ -30,26 +64,192 @@ typedef struct SAU_Output {
 	uint32_t options;
 	size_t buf_len;
 	size_t ch_len;
+	char *ckpt_path, *ckpt_tmp_path;
+	FILE *resume_f;
+	uint32_t resume_prg;
+	uint32_t prg_i;
+	uint32_t wf_samples;
+	uint64_t ckpt_len, ckpt_pos;
+	SAU_CostCalib calib;
+	float budget;
+	PlayStats play, play_span;
 } SAU_Output;
 
+static void init_PlayStats(PlayStats *restrict o,
+		const SAU_AudioDev *restrict ad) {
+	*o = (PlayStats){0};
+	o->min_headroom = 1.0;
+	SAU_AudioDev_get_stats(ad, &o->dev);
+}
+
+/*
+ * Count period of \p len samples with \p load.
+ */
+static void PlayStats_add(PlayStats *restrict o, double load, size_t len) {
+	int32_t bin = load * (LOAD_BINS / 2);
+	if (bin < 0) bin = 0;
+	if (bin >= LOAD_BINS) bin = LOAD_BINS - 1;
+	++o->load_bins[bin];
+	++o->periods;
+	o->samples += len;
+	double headroom = 1.0 - load;
+	if (headroom < o->min_headroom)
+		o->min_headroom = headroom;
+	o->sum_headroom += headroom;
+}
+
+/*
+ * \return headroom which 99% of periods had at least, rounded down
+ *         to the nearest bin
+ */
+static double PlayStats_p99_headroom(const PlayStats *restrict o) {
+	uint32_t limit = o->periods - o->periods / 100;
+	uint32_t count = 0;
+	double headroom = o->min_headroom;
+	for (uint32_t i = 0; i < LOAD_BINS - 1; ++i) {
+		count += o->load_bins[i];
+		if (count >= limit) {
+			headroom = 1.0 - (i + 1) * (2.0 / LOAD_BINS);
+			break;
+		}
+	}
+	return (headroom > o->min_headroom) ? headroom : o->min_headroom;
+}
+
+/*
+ * Print headroom statistics for \p o, without newline.
+ */
+static void PlayStats_print_headroom(const PlayStats *restrict o) {
+	fprintf(stdout, "min %.1f%%, mean %.1f%%, p99 %.1f%%",
+		o->min_headroom * 100.0,
+		(o->periods > 0) ? o->sum_headroom * 100.0 / o->periods : 0.0,
+		PlayStats_p99_headroom(o) * 100.0);
+}
+
+/*
+ * Get device statistics for audio device \p ad
+ * since the start of \p o.
+ */
+static void PlayStats_get_dev(const PlayStats *restrict o,
+		const SAU_AudioDev *restrict ad,
+		SAU_AudioDevStats *restrict dev) {
+	SAU_AudioDev_get_stats(ad, dev);
+	dev->xruns -= o->dev.xruns;
+	dev->recoveries -= o->dev.recoveries;
+	dev->errors -= o->dev.errors;
+}
+
 /*
  * \return true unless error occurred
  */
 static bool SAU_fini_Output(SAU_Output *restrict o) {
 	free(o->buf);
+	free(o->ckpt_path);
+	free(o->ckpt_tmp_path);
+	if (o->resume_f != NULL) fclose(o->resume_f);
 	if (o->ad != NULL) SAU_close_AudioDev(o->ad);
 	if (o->wf != NULL)
 		return (SAU_close_WAVFile(o->wf) == 0);
 	return true;
 }
 
+/*
+ * Allocate string holding \p path with \p ext appended.
+ */
+static char *dup_path_ext(const char *restrict path,
+		const char *restrict ext) {
+	size_t len = strlen(path), ext_len = strlen(ext);
+	char *str = malloc(len + ext_len + 1);
+	if (!str)
+		return NULL;
+	memcpy(str, path, len);
+	memcpy(&str[len], ext, ext_len + 1);
+	return str;
+}
+
+/*
+ * Set up checkpoint use for WAV file output to \p wav_path,
+ * and open the WAV file, resuming it if requested and possible.
+ *
+ * \return true unless error occurred
+ */
+static bool init_checkpoints(SAU_Output *restrict o, uint32_t srate,
+		const char *restrict wav_path, uint32_t ckpt_secs) {
+	CkptHead h;
+	o->ckpt_path = dup_path_ext(wav_path, CKPT_EXT);
+	o->ckpt_tmp_path = dup_path_ext(wav_path, CKPT_TMP_EXT);
+	if (!o->ckpt_path || !o->ckpt_tmp_path)
+		return false;
+	o->ckpt_len = (uint64_t) ckpt_secs * srate;
+	if ((o->options & SAU_ARG_RESUME) != 0) {
+		o->resume_f = fopen(o->ckpt_path, "rb");
+		if (!o->resume_f) {
+			SAU_warning(NULL,
+"no checkpoint file \"%s\", rendering from the beginning",
+				o->ckpt_path);
+		} else {
+			if (fread(&h, sizeof(h), 1, o->resume_f) != 1 ||
+			    memcmp(h.magic, CKPT_MAGIC, sizeof(h.magic))) {
+				SAU_error(NULL,
+"invalid checkpoint file \"%s\"", o->ckpt_path);
+				return false;
+			}
+			o->resume_prg = h.prg_i;
+			o->wf_samples = h.wf_samples;
+			o->wf = SAU_resume_WAVFile(wav_path,
+					NUM_CHANNELS, srate, h.wf_samples);
+			return (o->wf != NULL);
+		}
+	}
+	o->wf = SAU_create_WAVFile(wav_path, NUM_CHANNELS, srate);
+	return (o->wf != NULL);
+}
+
+/*
+ * Write checkpoint for the state of audio generation for WAV file,
+ * replacing any previous checkpoint once successfully written.
+ *
+ * \return true unless error occurred
+ */
+static bool write_checkpoint(SAU_Output *restrict o,
+		const SAU_Interp *restrict gen) {
+	CkptHead h = {CKPT_MAGIC, o->prg_i, o->wf_samples};
+	FILE *f;
+	bool ok = SAU_WAVFile_flush(o->wf);
+	if (ok && (f = fopen(o->ckpt_tmp_path, "wb")) != NULL) {
+		ok = (fwrite(&h, sizeof(h), 1, f) == 1) &&
+			SAU_Interp_save(gen, f);
+		if (fclose(f) != 0) ok = false;
+		if (ok) ok = (rename(o->ckpt_tmp_path, o->ckpt_path) == 0);
+	} else {
+		ok = false;
+	}
+	if (!ok)
+		SAU_warning(NULL, "couldn't write checkpoint file \"%s\"",
+				o->ckpt_path);
+	return ok;
+}
+
 /*
  * Set up use of audio device and/or WAV file, and buffer of suitable size.
  *
+ * If \p ckpt_secs is non-zero, or resuming is requested, checkpoints
+ * for WAV file output are enabled. These are not used when the audio
+ * device is also used.
+ *
+ * If cost estimates are requested, kernel timing is first obtained,
+ * using calibration kept in \p cache_dir if not NULL.
+ *
+ * If \p budget_pct is non-zero, audio device output is generated in
+ * real-time mode, dropping voices to stay within that percentage of
+ * real time.
+ *
  * \return true unless error occurred
  */
 static bool SAU_init_Output(SAU_Output *restrict o, uint32_t srate,
-		uint32_t options, const char *restrict wav_path) {
+		uint32_t options, const char *restrict wav_path,
+		uint32_t ckpt_secs, const char *restrict cache_dir,
+		uint32_t budget_pct) {
 	bool use_audiodev = (wav_path != NULL) ?
 		((options & SAU_ARG_AUDIO_ENABLE) != 0) :
 		((options & SAU_ARG_AUDIO_DISABLE) == 0);
@@ -57,6 +257,10 @@ static bool SAU_init_Output(SAU_Output *restrict o, uint32_t srate,
 	uint32_t max_srate = srate;
 	*o = (SAU_Output){0};
 	o->options = options;
+	o->budget = budget_pct * 0.01f;
+	if ((options & SAU_ARG_PRINT_COST) != 0 &&
+	    !SAU_calibrate_Cost(&o->calib, cache_dir))
+		return false;
 	if ((options & SAU_ARG_MODE_CHECK) != 0)
 		return true;
 	if (use_audiodev) {
@@ -75,14 +279,312 @@ static bool SAU_init_Output(SAU_Output *restrict o, uint32_t srate,
 	o->buf = calloc(o->buf_len, sizeof(int16_t));
 	if (!o->buf) goto ERROR;
 	if (wav_path != NULL) {
-		o->wf = SAU_create_WAVFile(wav_path, NUM_CHANNELS, srate);
-		if (!o->wf) goto ERROR;
+		bool use_ckpt = (ckpt_secs > 0) ||
+			((options & SAU_ARG_RESUME) != 0);
+		if (use_ckpt && o->ad != NULL) {
+			SAU_warning(NULL,
+"checkpoints not used with audio device output");
+			use_ckpt = false;
+		}
+		if (use_ckpt) {
+			if (!init_checkpoints(o, srate, wav_path, ckpt_secs))
+				goto ERROR;
+		} else {
+			o->wf = SAU_create_WAVFile(wav_path,
+					NUM_CHANNELS, srate);
+			if (!o->wf) goto ERROR;
+		}
 	}
 	return true;
 ERROR:
 	return SAU_fini_Output(o);
 }
 
+/*
+ * Print memory statistics for interpreter \p gen running \p prg.
+ */
+static void print_interp_mem_stats(const SAU_Interp *restrict gen,
+		const SAU_Program *restrict prg) {
+	SAU_InterpMemStats stats;
+	SAU_Interp_get_mem_stats(gen, &stats);
+	fprintf(stdout, "Memory: \"%s\"\n", prg->name);
+	SAU_print_mem_stats("Interp: ", &stats.pool);
+	fprintf(stdout,
+		"\tScratch:\t%u buffers of %zu (%u needed), %zu for mixing\n",
+		stats.buf_count, stats.buf_size, stats.max_bufs,
+		stats.mix_size);
+}
+
+/*
+ * Profile entry, for ranking operators and voices by time.
+ */
+typedef struct ProfEntry {
+	uint64_t ns;
+	uint32_t id;
+} ProfEntry;
+
+static int cmp_prof_entry(const void *restrict a, const void *restrict b) {
+	uint64_t ns_a = ((const ProfEntry*) a)->ns;
+	uint64_t ns_b = ((const ProfEntry*) b)->ns;
+	return (ns_a < ns_b) - (ns_a > ns_b);
+}
+
+/*
+ * Sort the first \p count entries, keeping those with time.
+ *
+ * \return number of entries with time
+ */
+static uint32_t rank_prof_entries(ProfEntry *restrict entries,
+		uint32_t count) {
+	qsort(entries, count, sizeof(ProfEntry), cmp_prof_entry);
+	while (count > 0 && !entries[count - 1].ns)
+		--count;
+	return count;
+}
+
+/*
+ * Create interpreter for \p prg, recording spans if tracing.
+ *
+ * \return instance or NULL on error
+ */
+static SAU_Interp *create_interp(const SAU_Program *restrict prg,
+		uint32_t srate) {
+	uint64_t t = SAU_Trace_begin();
+	SAU_Interp *gen = SAU_create_Interp(prg, srate, true);
+	SAU_Trace_end(t, "interp", "prealloc", prg->name);
+	if (gen != NULL && SAU_Trace_enabled() &&
+	    !SAU_Interp_set_trace(gen, TRACE_SPANS)) {
+		SAU_destroy_Interp(gen);
+		return NULL;
+	}
+	return gen;
+}
+
+/*
+ * Write the spans recorded by \p gen since last done
+ * to the trace file.
+ */
+static void put_interp_trace(SAU_Interp *restrict gen) {
+	static const char *const names[SAU_SPAN_KINDS] = {
+		"run",
+		"prealloc prepare",
+		"event",
+		"mix write",
+	};
+	static const char *const keys[SAU_SPAN_KINDS] = {
+		"samples",
+		"events",
+		"id",
+		"samples",
+	};
+	SAU_InterpTrace *trace = SAU_Interp_get_trace(gen);
+	if (!trace)
+		return;
+	for (uint32_t i = 0; i < trace->count; ++i) {
+		const SAU_InterpSpan *span = &trace->spans[i];
+		SAU_Trace_put_n(span->start, span->end, "interp",
+				names[span->kind], keys[span->kind], span->n);
+	}
+	trace->count = 0;
+}
+
+/*
+ * Destroy interpreter \p gen used for \p prg, after writing any spans
+ * left to the trace file, warning if some weren't recorded.
+ */
+static void destroy_interp(SAU_Interp *restrict gen,
+		const SAU_Program *restrict prg) {
+	SAU_InterpTrace *trace = SAU_Interp_get_trace(gen);
+	if (trace != NULL) {
+		put_interp_trace(gen);
+		if (trace->dropped > 0)
+			SAU_warning(NULL,
+"\"%s\": %u trace spans dropped, more than %u per run",
+				prg->name, trace->dropped, TRACE_SPANS);
+	}
+	SAU_destroy_Interp(gen);
+}
+
+/*
+ * Print profile for interpreter \p gen running \p prg, with the
+ * operators and voices taking the most time.
+ */
+static void print_profile(const SAU_Interp *restrict gen,
+		const SAU_Program *restrict prg) {
+	static const char *const kernel_names[SAU_PROF_KERNELS] = {
+		"osc",
+		"ramp",
+		"combine",
+		"mix",
+	};
+	static const char *const uses[SAU_POP_USES] = {
+		"CA",
+		"FM",
+		"PM",
+		"AM"
+	};
+	const SAU_InterpProfile *prof = SAU_Interp_get_profile(gen);
+	if (!prof)
+		return;
+	double total_ms = prof->ns / 1000000.0;
+	double pc_scale = (prof->ns > 0) ? 100.0 / prof->ns : 0.0;
+	fprintf(stdout, "Profile: \"%s\"\n", prg->name);
+	fprintf(stdout,
+		"\tTotal:   \t%.3f ms for %.3f M samples (%.1f ns/sample)\n",
+		total_ms, prof->samples / 1000000.0,
+		(prof->samples > 0) ? (double) prof->ns / prof->samples : 0.0);
+	fputs("\tKernels: \t", stdout);
+	for (int i = 0; i < SAU_PROF_KERNELS; ++i)
+		fprintf(stdout, "%s%s %.3f ms (%.1f%%)",
+			(i > 0) ? ", " : "", kernel_names[i],
+			prof->kernel_ns[i] / 1000000.0,
+			prof->kernel_ns[i] * pc_scale);
+	putc('\n', stdout);
+	uint32_t max_count = (prof->op_count > prof->vo_count) ?
+		prof->op_count : prof->vo_count;
+	ProfEntry *entries = calloc(max_count, sizeof(ProfEntry));
+	if (!entries)
+		return;
+	for (uint32_t i = 0; i < prof->op_count; ++i)
+		entries[i] = (ProfEntry){prof->ops[i].ns, i};
+	uint32_t count = rank_prof_entries(entries, prof->op_count);
+	fprintf(stdout,
+		"\tOperators:\t%u run, top by own kernel time:\n"
+		"\t    %6s  %-4s  %-11s  %10s  %6s  %10s\n",
+		count, "ID", "wave", "use", "ms", "%", "M samples");
+	for (uint32_t i = 0; i < count && i < PROF_TOP_OPS; ++i) {
+		const SAU_InterpOpProfile *op = &prof->ops[entries[i].id];
+		char use_str[SAU_POP_USES * 3] = "";
+		for (int u = 0; u < SAU_POP_USES; ++u) {
+			if (!(op->uses & (1 << u))) continue;
+			if (use_str[0] != '\0') strcat(use_str, ",");
+			strcat(use_str, uses[u]);
+		}
+		fprintf(stdout,
+			"\t    %6u  %-4s  %-11s  %10.3f  %5.1f%%  %10.3f\n",
+			entries[i].id, SAU_Wave_names[op->wave], use_str,
+			op->ns / 1000000.0, op->ns * pc_scale,
+			op->samples / 1000000.0);
+	}
+	for (uint32_t i = 0; i < prof->vo_count; ++i)
+		entries[i] = (ProfEntry){prof->voices[i].ns, i};
+	count = rank_prof_entries(entries, prof->vo_count);
+	fprintf(stdout,
+		"\tVoices:  \t%u run, top by time including mixing:\n"
+		"\t    %6s  %10s  %6s  %10s\n",
+		count, "ID", "ms", "%", "M samples");
+	for (uint32_t i = 0; i < count && i < PROF_TOP_VOICES; ++i) {
+		const SAU_InterpVoiceProfile *vo =
+			&prof->voices[entries[i].id];
+		fprintf(stdout, "\t    %6u  %10.3f  %5.1f%%  %10.3f\n",
+			entries[i].id, vo->ns / 1000000.0,
+			vo->ns * pc_scale, vo->samples / 1000000.0);
+	}
+	free(entries);
+}
+
+/*
+ * Print render cost estimate for \p prg at \p srate.
+ */
+static void print_cost(const SAU_Output *restrict o,
+		const SAU_Program *restrict prg, uint32_t srate) {
+	SAU_Cost cost;
+	if (SAU_estimate_Cost(&cost, prg, srate, &o->calib))
+		SAU_Cost_print(&cost, prg->name);
+}
+
+/*
+ * Log any increase in voices dropped to keep within real-time budget,
+ * for the run ending \p pos samples into the audio of \p gen.
+ */
+static void log_budget_drops(const SAU_Interp *restrict gen,
+		uint32_t *restrict logged, uint64_t pos, uint32_t srate) {
+	SAU_InterpBudgetStats stats;
+	SAU_Interp_get_budget_stats(gen, &stats);
+	if (stats.dropped > *logged)
+		SAU_warning(NULL,
+"over real-time budget at %.1f s, dropping %u quietest voices",
+			(double) pos / srate, stats.dropped);
+	*logged = stats.dropped;
+}
+
+/*
+ * Print summary of real-time budget use by \p gen running \p prg,
+ * if it went over budget.
+ */
+static void print_budget_stats(const SAU_Interp *restrict gen,
+		const SAU_Program *restrict prg) {
+	SAU_InterpBudgetStats stats;
+	SAU_Interp_get_budget_stats(gen, &stats);
+	if (!stats.over_runs)
+		return;
+	SAU_warning(NULL,
+"\"%s\" over real-time budget in %u of %u runs, peak load %.0f%%; up to %u voices dropped",
+		prg->name, stats.over_runs, stats.runs,
+		stats.max_load * 100.f, stats.max_dropped);
+}
+
+/*
+ * Write \p len samples to the audio device, counting the period in
+ * statistics, given \p gen_ns spent generating it. With --stats,
+ * statistics for the latest span of periods are printed at intervals.
+ *
+ * \return true unless write failed
+ */
+static bool write_audiodev(SAU_Output *restrict o,
+		const SAU_Program *restrict prg,
+		size_t len, uint64_t gen_ns) {
+	uint64_t t = SAU_Trace_begin();
+	bool ok = SAU_AudioDev_write(o->ad, o->buf, len);
+	if (!ok)
+		SAU_error(NULL, "audio device write failed");
+	SAU_Trace_end_n(t, "output", "device write", "samples", len);
+	double load = gen_ns * 1e-9 * o->ad_srate / len;
+	PlayStats_add(&o->play, load, len);
+	if ((o->options & SAU_ARG_PLAY_STATS) != 0) {
+		PlayStats_add(&o->play_span, load, len);
+		if (o->play_span.samples >=
+		    (uint64_t) SAU_STATS_SECS * o->ad_srate) {
+			SAU_AudioDevStats dev;
+			PlayStats_get_dev(&o->play_span, o->ad, &dev);
+			fprintf(stdout, "Stats: \"%s\" at %.1f s: headroom ",
+				prg->name,
+				(double) o->play.samples / o->ad_srate);
+			PlayStats_print_headroom(&o->play_span);
+			fprintf(stdout, "; %u underruns\n", dev.xruns);
+			init_PlayStats(&o->play_span, o->ad);
+		}
+	}
+	return ok;
+}
+
+/*
+ * Print statistics for audio device output of \p prg, if --stats
+ * is used; otherwise, warn if it didn't keep up.
+ */
+static void print_play_stats(const SAU_Output *restrict o,
+		const SAU_Program *restrict prg) {
+	const PlayStats *play = &o->play;
+	SAU_AudioDevStats dev;
+	PlayStats_get_dev(play, o->ad, &dev);
+	if ((o->options & SAU_ARG_PLAY_STATS) != 0) {
+		fprintf(stdout, "Stats: \"%s\"\n", prg->name);
+		fprintf(stdout, "\tPeriods: \t%u of %u ms, %.3f s in all\n",
+			play->periods, BUF_TIME_MS,
+			(double) play->samples / o->ad_srate);
+		fputs("\tHeadroom:\t", stdout);
+		PlayStats_print_headroom(play);
+		fprintf(stdout,
+			"\n\tDevice:  \t%u underruns, %u recovered, %u failed writes\n",
+			dev.xruns, dev.recoveries, dev.errors);
+		return;
+	}
+	if (dev.xruns > 0 || play->min_headroom < 0.0)
+		SAU_warning(NULL,
+"\"%s\" didn't keep up with audio device: %u underruns, headroom min %.1f%%",
+			prg->name, dev.xruns, play->min_headroom * 100.0);
+}
+
 /*
  * Produce audio for program \p prg, optionally sending it
  * to the audio device and/or WAV file.
@@ -93,43 +595,102 @@ static bool SAU_Output_run(SAU_Output *restrict o,
 		const SAU_Program *restrict prg,
 		bool split_gen, uint32_t other_srate) {
 	uint32_t srate = (o->ad != NULL) ? o->ad_srate : other_srate;
-	SAU_Interp *gen = SAU_create_Interp(prg, srate);
+	SAU_Interp *gen = create_interp(prg, srate);
 	if (!gen)
 		return false;
 	size_t len;
+	uint64_t pos = 0;
+	uint32_t dropped = 0;
 	bool error = false;
 	bool run = !(o->options & SAU_ARG_MODE_CHECK);
-	if ((o->options & SAU_ARG_PRINT_INFO) != 0)
-		SAU_Interp_print(gen);
+	if ((o->options & SAU_ARG_PRINT_INFO) != 0 &&
+	    !SAU_Interp_print(gen)) {
+		destroy_interp(gen, prg);
+		return false;
+	}
+	if ((o->options & SAU_ARG_PRINT_COST) != 0)
+		print_cost(o, prg, srate);
+	if (o->resume_f != NULL) {
+		bool restored = SAU_Interp_restore(gen, o->resume_f);
+		fclose(o->resume_f);
+		o->resume_f = NULL;
+		if (!restored) {
+			destroy_interp(gen, prg);
+			return false;
+		}
+	}
+	bool use_budget = run && (o->ad != NULL) && (o->budget > 0.f);
+	if (use_budget && !SAU_Interp_set_budget(gen, o->budget)) {
+		destroy_interp(gen, prg);
+		return false;
+	}
+	if (run && (o->ad != NULL)) {
+		init_PlayStats(&o->play, o->ad);
+		init_PlayStats(&o->play_span, o->ad);
+	}
 	if (run && split_gen && (o->ad != NULL)) {
 		for (;;) {
+			uint64_t gen_t = SAU_time_ns();
 			len = SAU_Interp_run(gen, o->buf, o->ch_len);
+			put_interp_trace(gen);
 			if (!len) break;
-			if (!SAU_AudioDev_write(o->ad, o->buf, len)) {
+			if (!write_audiodev(o, prg, len, SAU_time_ns() - gen_t))
 				error = true;
-				SAU_error(NULL, "audio device write failed");
-			}
+			if (use_budget)
+				log_budget_drops(gen, &dropped,
+						pos += len, srate);
 		}
-		SAU_destroy_Interp(gen);
-		gen = SAU_create_Interp(prg, other_srate);
+		if (use_budget)
+			print_budget_stats(gen, prg);
+		use_budget = false;
+		print_play_stats(o, prg);
+		destroy_interp(gen, prg);
+		gen = create_interp(prg, other_srate);
 		if (!gen)
 			return false;
 	}
+	bool use_profile = run && (o->options & SAU_ARG_PROFILE) != 0;
+	if (use_profile && !SAU_Interp_set_profile(gen, true)) {
+		destroy_interp(gen, prg);
+		return false;
+	}
 	bool use_audiodev = !split_gen && (o->ad != NULL);
 	bool use_wavfile = (o->wf != NULL);
 	if (run) for (;;) {
+		uint64_t gen_t = SAU_time_ns();
 		len = SAU_Interp_run(gen, o->buf, o->ch_len);
+		put_interp_trace(gen);
 		if (!len) break;
-		if (use_audiodev && !SAU_AudioDev_write(o->ad, o->buf, len)) {
-			error = true;
-			SAU_error(NULL, "audio device write failed");
-		}
-		if (use_wavfile && !SAU_WAVFile_write(o->wf, o->buf, len)) {
+		if (use_audiodev &&
+		    !write_audiodev(o, prg, len, SAU_time_ns() - gen_t))
 			error = true;
-			SAU_error(NULL, "WAV file write failed");
+		if (use_budget)
+			log_budget_drops(gen, &dropped, pos += len, srate);
+		if (use_wavfile) {
+			uint64_t t = SAU_Trace_begin();
+			if (!SAU_WAVFile_write(o->wf, o->buf, len)) {
+				error = true;
+				SAU_error(NULL, "WAV file write failed");
+			}
+			SAU_Trace_end_n(t, "output", "wav write",
+					"samples", len);
+			o->wf_samples += len;
+			if (o->ckpt_len > 0 &&
+			    (o->ckpt_pos += len) >= o->ckpt_len) {
+				o->ckpt_pos = 0;
+				write_checkpoint(o, gen);
+			}
 		}
 	}
-	SAU_destroy_Interp(gen);
+	if (use_budget)
+		print_budget_stats(gen, prg);
+	if (run && use_audiodev)
+		print_play_stats(o, prg);
+	if (use_profile)
+		print_profile(gen, prg);
+	if ((o->options & SAU_ARG_MEM_STATS) != 0)
+		print_interp_mem_stats(gen, prg);
+	destroy_interp(gen, prg);
 	return !error;
 }
 
@@ -138,17 +699,29 @@ static bool SAU_Output_run(SAU_Output *restrict o,
  * ignoring NULL entries.
  *
  * The output is sent to either none, one, or both of the audio device
- * or a WAV file.
+ * or a WAV file. For WAV file output, a checkpoint may be written every
+ * \p ckpt_secs seconds of audio, allowing an interrupted run to be
+ * resumed by passing the same arguments along with SAU_ARG_RESUME.
+ *
+ * With SAU_ARG_PRINT_COST, \p cache_dir (if not NULL) keeps the
+ * kernel timing used for cost estimates.
+ *
+ * If \p budget_pct is non-zero, the quietest voices are dropped when
+ * needed to generate audio device output within that percentage of
+ * real time; any WAV file written at the same time gets the same audio.
  *
  * \return true unless error occurred
  */
 bool SAU_play(const SAU_PtrArr *restrict prg_objs, uint32_t srate,
-		uint32_t options, const char *restrict wav_path) {
+		uint32_t options, const char *restrict wav_path,
+		uint32_t ckpt_secs, const char *restrict cache_dir,
+		uint32_t budget_pct) {
 	if (!prg_objs->count)
 		return true;
 
 	SAU_Output out;
-	if (!SAU_init_Output(&out, srate, options, wav_path))
+	if (!SAU_init_Output(&out, srate, options, wav_path, ckpt_secs,
+			cache_dir, budget_pct))
 		return false;
 	bool status = true;
 	bool split_gen = false;
@@ -162,8 +735,17 @@ bool SAU_play(const SAU_PtrArr *restrict prg_objs, uint32_t srate,
 	for (size_t i = 0; i < prg_objs->count; ++i) {
 		const SAU_Program *prg = prgs[i];
 		if (!prg) continue;
-		if (!SAU_Output_run(&out, prg, split_gen, srate))
+		bool resume = (out.resume_f != NULL);
+		if (resume && i < out.resume_prg) continue;
+		out.prg_i = i;
+		if (!SAU_Output_run(&out, prg, split_gen, srate)) {
 			status = false;
+			if (resume) break;
+		}
+	}
+	if (status && out.ckpt_path != NULL) {
+		remove(out.ckpt_path);
+		remove(out.ckpt_tmp_path);
 	}
 	if (!SAU_fini_Output(&out))
 		status = false;
@@ -0,0 +1,389 @@
+/* saugns: Local render server module.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../saugns.h"
+#include "../arrtype.h"
+#include "../interp/interp.h"
+#include "wavfile.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+/*
+ * Requests are made by connecting to the socket, sending a header line
+ * of space-separated options, then the script text, and shutting down
+ * writing. Options are "srate=<Hz>", "format=wav" or "format=pcm", and
+ * "render=stream" or "render=full".
+ *
+ * The reply is a line "OK build_ms=<time>\n" followed by audio as it's
+ * generated, or a line "ERR <message>\n". Audio is 16-bit stereo, as a
+ * WAV stream (with the length unspecified in the header) or raw
+ * little-endian PCM. With "render=full", all audio is rendered before
+ * replying, and the line is instead
+ * "OK build_ms=<time> render_ms=<time> frames=<count>\n", with the
+ * WAV header giving the length. Times are in milliseconds; build time
+ * covers reading the request, building the program, and setting up.
+ *
+ * Worker processes, forked in advance and each handling one request at
+ * a time, limit concurrency. They are kept between requests, so wave
+ * tables and buffers are only set up once. Memory pools for programs
+ * and interpreters are reused between requests through the per-thread
+ * cache of SAU_obtain_MemPool(), rather than keeping interpreters.
+ */
+
+#define BUF_FRAMES   4096
+#define NUM_CHANNELS 2
+#define MAX_SRATE    768000
+#define MAX_FULL_FRAMES (1 << 26) /* limit for render=full buffering */
+#define MAX_KEEP_BYTES  (1 << 24) /* larger buffers are freed after use */
+
+static volatile sig_atomic_t quit = 0;
+
+static void handle_quit(int sig) {
+	(void)sig;
+	quit = 1;
+}
+
+typedef struct Worker {
+	uint32_t id;
+	uint32_t def_srate;
+	uint32_t requests;
+	SAU_ByteArr text;
+	SAU_ByteArr audio;
+	int16_t buf[BUF_FRAMES * NUM_CHANNELS];
+} Worker;
+
+/*
+ * Read request text until end of input, adding a terminating zero byte.
+ *
+ * \return true unless read or allocation failed
+ */
+static bool read_text(Worker *restrict o, int fd) {
+	o->text.count = 0;
+	for (;;) {
+		if (!SAU_ByteArr_upsize(&o->text, o->text.count + 4096))
+			return false;
+		ssize_t len = read(fd, &o->text.a[o->text.count],
+				o->text.asize - o->text.count - 1);
+		if (len < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		if (!len) break;
+		o->text.count += len;
+	}
+	o->text.a[o->text.count] = '\0';
+	return true;
+}
+
+/*
+ * Parse request header line in \p line, ending at the first newline,
+ * which is replaced with a zero byte.
+ *
+ * \return start of script text, or NULL on invalid header
+ */
+static char *parse_header(char *restrict line,
+		uint32_t *restrict srate, bool *restrict use_wav,
+		bool *restrict full) {
+	char *end = strchr(line, '\n');
+	if (!end)
+		return NULL;
+	*end = '\0';
+	for (char *tok = strtok(line, " \t\r"); tok != NULL;
+			tok = strtok(NULL, " \t\r")) {
+		if (!strncmp(tok, "srate=", 6)) {
+			char *endp;
+			long i = strtol(tok + 6, &endp, 10);
+			if (*endp || i <= 0 || i > MAX_SRATE)
+				return NULL;
+			*srate = i;
+		} else if (!strcmp(tok, "format=wav")) {
+			*use_wav = true;
+		} else if (!strcmp(tok, "format=pcm")) {
+			*use_wav = false;
+		} else if (!strcmp(tok, "render=stream")) {
+			*full = false;
+		} else if (!strcmp(tok, "render=full")) {
+			*full = true;
+		} else {
+			return NULL;
+		}
+	}
+	return end + 1;
+}
+
+/*
+ * Render all audio from \p gen into the audio buffer,
+ * setting \p frames to the length.
+ *
+ * \return true unless allocation failed or the length limit was hit
+ */
+static bool render_full(Worker *restrict o, SAU_Interp *restrict gen,
+		size_t *restrict frames) {
+	const size_t frame_size = NUM_CHANNELS * sizeof(int16_t);
+	o->audio.count = 0;
+	for (;;) {
+		size_t count = o->audio.count + BUF_FRAMES * frame_size;
+		if (count > (size_t) MAX_FULL_FRAMES * frame_size ||
+		    !SAU_ByteArr_upsize(&o->audio, count))
+			return false;
+		size_t len = SAU_Interp_run(gen,
+				(int16_t*) &o->audio.a[o->audio.count],
+				BUF_FRAMES);
+		if (!len) break;
+		o->audio.count += len * frame_size;
+	}
+	*frames = o->audio.count / frame_size;
+	return true;
+}
+
+/*
+ * Handle request on connection \p fd, closing it when done.
+ */
+static void handle_request(Worker *restrict o, int fd) {
+	FILE *f = fdopen(fd, "wb");
+	if (!f) {
+		close(fd);
+		return;
+	}
+	const char *err = NULL;
+	uint32_t srate = o->def_srate;
+	bool use_wav = true, full = false, replied = false;
+	SAU_Program *prg = NULL;
+	SAU_Interp *gen = NULL;
+	size_t frames = 0;
+	uint64_t t0 = SAU_time_ns();
+	double t_build = 0.0, t_render = 0.0;
+	char *script;
+	++o->requests;
+	if (!read_text(o, fd)) {
+		err = "couldn't read request";
+		goto DONE;
+	}
+	if (!o->text.count) {
+		/* connection only, e.g. checking if server is running */
+		--o->requests;
+		fclose(f);
+		return;
+	}
+	script = parse_header((char*) o->text.a, &srate, &use_wav, &full);
+	if (!script) {
+		err = "invalid header line";
+		goto DONE;
+	}
+	prg = SAU_load_Program(script, false);
+	if (!prg) {
+		err = "script build failed";
+		goto DONE;
+	}
+	gen = SAU_create_Interp(prg, srate, true);
+	if (!gen) {
+		err = "interpreter setup failed";
+		goto DONE;
+	}
+	uint64_t t1 = SAU_time_ns();
+	t_build = (t1 - t0) * 1e-6;
+	if (full) {
+		if (!render_full(o, gen, &frames)) {
+			err = "couldn't buffer audio for render=full";
+			goto DONE;
+		}
+		t_render = (SAU_time_ns() - t1) * 1e-6;
+		fprintf(f, "OK build_ms=%.3f render_ms=%.3f frames=%zu\n",
+				t_build, t_render, frames);
+		replied = true;
+		if (use_wav)
+			SAU_put_WAVHeader(f, NUM_CHANNELS, srate, frames);
+		if (fwrite(o->audio.a, 1, o->audio.count, f)
+				!= o->audio.count)
+			err = "client went away";
+		goto DONE;
+	}
+	fprintf(f, "OK build_ms=%.3f\n", t_build);
+	replied = true;
+	if (use_wav)
+		SAU_put_WAVHeader(f, NUM_CHANNELS, srate, UINT32_MAX);
+	for (;;) {
+		size_t len = SAU_Interp_run(gen, o->buf, BUF_FRAMES);
+		if (!len) break;
+		if (fwrite(o->buf, NUM_CHANNELS * sizeof(int16_t), len, f)
+				!= len) {
+			err = "client went away";
+			break;
+		}
+		frames += len;
+	}
+	fflush(f);
+	t_render = (SAU_time_ns() - t1) * 1e-6;
+DONE:
+	if (err != NULL && !replied)
+		fprintf(f, "ERR %s\n", err);
+	fclose(f);
+	if (o->audio.asize > MAX_KEEP_BYTES)
+		SAU_ByteArr_clear(&o->audio);
+	fprintf(stderr,
+"serve: worker %u request %u: %s; build %.3f ms, render %.3f ms, %zu frames at %u Hz\n",
+		o->id, o->requests, (err != NULL) ? err : "ok",
+		t_build, t_render, frames, srate);
+	SAU_destroy_Interp(gen);
+	SAU_discard_Program(prg);
+}
+
+/*
+ * Worker process main loop.
+ */
+static void run_worker(uint32_t id, int lfd, uint32_t srate) {
+	static Worker w;
+	w.id = id;
+	w.def_srate = srate;
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	for (;;) {
+		int fd = accept(lfd, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			SAU_error("serve", "accept failed: %s",
+					strerror(errno));
+			exit(1);
+		}
+		handle_request(&w, fd);
+	}
+}
+
+/*
+ * Fork worker \p id.
+ *
+ * \return process ID, or -1 on failure
+ */
+static pid_t start_worker(uint32_t id, int lfd, uint32_t srate) {
+	pid_t pid = fork();
+	if (pid == 0) {
+		run_worker(id, lfd, srate);
+		exit(0);
+	}
+	if (pid < 0)
+		SAU_error("serve", "fork failed: %s", strerror(errno));
+	return pid;
+}
+
+/*
+ * Remove socket file at \p addr if left behind by a server no longer
+ * running, i.e. if it's a socket which nothing is listening on.
+ *
+ * \return true if removed
+ */
+static bool remove_stale_socket(const struct sockaddr_un *restrict addr) {
+	struct stat st;
+	if (lstat(addr->sun_path, &st) != 0 || !S_ISSOCK(st.st_mode))
+		return false;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return false;
+	bool stale = connect(fd, (const struct sockaddr*) addr,
+			sizeof(*addr)) != 0 && errno == ECONNREFUSED;
+	close(fd);
+	if (!stale || unlink(addr->sun_path) != 0)
+		return false;
+	SAU_warning("serve", "removed stale socket \"%s\"", addr->sun_path);
+	return true;
+}
+
+/**
+ * Listen on UNIX domain socket \p sock_path, rendering scripts sent
+ * using \p jobs worker processes, with \p srate as default sample rate.
+ * A socket file left by a crashed run is replaced.
+ * Runs until interrupted, then removes the socket.
+ *
+ * \return true unless setting up failed
+ */
+bool SAU_serve(const char *restrict sock_path, uint32_t srate,
+		uint32_t jobs) {
+	struct sockaddr_un addr = {0};
+	struct sigaction sa = {0};
+	pid_t *pids = NULL;
+	bool ok = false;
+	if (strlen(sock_path) >= sizeof(addr.sun_path)) {
+		SAU_error("serve", "socket path \"%s\" too long", sock_path);
+		return false;
+	}
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, sock_path);
+	int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+	bool bound = lfd >= 0 &&
+		bind(lfd, (struct sockaddr*) &addr, sizeof(addr)) == 0;
+	if (lfd >= 0 && !bound && errno == EADDRINUSE) {
+		if (remove_stale_socket(&addr))
+			bound = bind(lfd, (struct sockaddr*) &addr,
+					sizeof(addr)) == 0;
+		else
+			errno = EADDRINUSE;
+	}
+	if (!bound || listen(lfd, 64) != 0) {
+		SAU_error("serve", "couldn't listen on \"%s\": %s",
+				sock_path, strerror(errno));
+		if (lfd >= 0) close(lfd);
+		return false;
+	}
+	pids = calloc(jobs, sizeof(pid_t));
+	if (!pids) goto DONE;
+	SAU_global_init_Wave(); /* shared with workers */
+	signal(SIGPIPE, SIG_IGN);
+	sa.sa_handler = handle_quit;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	for (uint32_t i = 0; i < jobs; ++i) {
+		pids[i] = start_worker(i, lfd, srate);
+		if (pids[i] < 0) goto DONE;
+	}
+	fprintf(stderr, "serve: listening on \"%s\" with %u workers\n",
+			sock_path, jobs);
+	ok = true;
+	while (!quit) {
+		int status;
+		pid_t pid = wait(&status);
+		if (pid < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		if (quit) break;
+		/*
+		 * Replace worker which exited.
+		 */
+		for (uint32_t i = 0; i < jobs; ++i) {
+			if (pids[i] != pid) continue;
+			SAU_warning("serve", "restarting worker %u", i);
+			pids[i] = start_worker(i, lfd, srate);
+			if (pids[i] < 0) quit = 1;
+			break;
+		}
+	}
+DONE:
+	if (pids != NULL) {
+		for (uint32_t i = 0; i < jobs; ++i)
+			if (pids[i] > 0) kill(pids[i], SIGTERM);
+		while (wait(NULL) > 0 || errno == EINTR)
+			;
+		free(pids);
+	}
+	close(lfd);
+	unlink(sock_path);
+	return ok;
+}
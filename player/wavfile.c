@@ -18,6 +18,7 @@
 #include "wavfile.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 static void fputw(uint16_t i16, FILE *restrict stream) {
 	uint8_t b;
@@ -48,6 +49,32 @@ struct SAU_WAVFile {
 	uint32_t samples;
 };
 
+/**
+ * Write 16-bit WAV file header to \p f, for \p samples of audio data
+ * following it. If \p samples is UINT32_MAX, the length is left
+ * unspecified as for an audio stream.
+ */
+void SAU_put_WAVHeader(FILE *restrict f,
+		uint16_t channels, uint32_t srate, uint32_t samples) {
+	uint32_t bytes = (samples != UINT32_MAX) ?
+		channels * samples * SOUND_BYTES : UINT32_MAX;
+	fputs("RIFF", f);
+	fputl((bytes != UINT32_MAX) ? 36 + bytes : UINT32_MAX, f);
+	fputs("WAVE", f);
+
+	fputs("fmt ", f);
+	fputl(16, f); /* fmt-chunk size */
+	fputw(1, f); /* format */
+	fputw(channels, f);
+	fputl(srate, f); /* sample rate */
+	fputl(channels * srate * SOUND_BYTES, f); /* byte rate */
+	fputw(channels * SOUND_BYTES, f); /* block align */
+	fputw(SOUND_BITS, f); /* bits per sample */
+
+	fputs("data", f);
+	fputl(bytes, f); /* data-chunk size */
+}
+
 /**
  * Create 16-bit WAV file for audio output. Sound data may thereafter be
  * written any number of times using SAU_WAVFile_write().
@@ -66,23 +93,48 @@ SAU_WAVFile *SAU_create_WAVFile(const char *restrict fpath,
 	o->f = f;
 	o->channels = channels;
 	o->samples = 0;
+	/* sizes updated when closing */
+	SAU_put_WAVHeader(f, channels, srate, 0);
+	return o;
+}
 
-	fputs("RIFF", f);
-	fputl(36 /* update adding audio data size later */, f);
-	fputs("WAVE", f);
-
-	fputs("fmt ", f);
-	fputl(16, f); /* fmt-chunk size */
-	fputw(1, f); /* format */
-	fputw(channels, f);
-	fputl(srate, f); /* sample rate */
-	fputl(channels * srate * SOUND_BYTES, f); /* byte rate */
-	fputw(channels * SOUND_BYTES, f); /* block align */
-	fputw(SOUND_BITS, f); /* bits per sample */
-
-	fputs("data", f);
-	fputl(0 /* updated with data size later */, f); /* fmt-chunk size */
+static uint32_t getl(const uint8_t *restrict b) {
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t) b[3] << 24);
+}
 
+/**
+ * Reopen 16-bit WAV file written by an interrupted run, keeping
+ * the first \p samples of audio data. Further data written with
+ * SAU_WAVFile_write() replaces anything after that point.
+ *
+ * \return instance or NULL if the file can't be opened or
+ *         doesn't match the format and length given
+ */
+SAU_WAVFile *SAU_resume_WAVFile(const char *restrict fpath,
+		uint16_t channels, uint32_t srate, uint32_t samples) {
+	uint8_t head[44];
+	FILE *f = fopen(fpath, "r+b");
+	if (!f) {
+		SAU_error(NULL, "couldn't open WAV file \"%s\" for resuming",
+			fpath);
+		return NULL;
+	}
+	long pos = 44 + (long) samples * channels * SOUND_BYTES;
+	if (fread(head, sizeof(head), 1, f) != 1 ||
+			memcmp(head, "RIFF", 4) || memcmp(&head[8], "WAVE", 4) ||
+			(head[22] | (head[23] << 8)) != channels ||
+			getl(&head[24]) != srate ||
+			fseek(f, 0, SEEK_END) != 0 || ftell(f) < pos ||
+			fseek(f, pos, SEEK_SET) != 0) {
+		SAU_error(NULL, "WAV file \"%s\" doesn't match resumed output",
+			fpath);
+		fclose(f);
+		return NULL;
+	}
+	SAU_WAVFile *o = malloc(sizeof(SAU_WAVFile));
+	o->f = f;
+	o->channels = channels;
+	o->samples = samples;
 	return o;
 }
 
@@ -101,6 +153,15 @@ bool SAU_WAVFile_write(SAU_WAVFile *restrict o,
 	return (written == samples);
 }
 
+/**
+ * Flush audio data written so far to the file.
+ *
+ * \return true if successful
+ */
+bool SAU_WAVFile_flush(SAU_WAVFile *restrict o) {
+	return (fflush(o->f) == 0);
+}
+
 /**
  * Close file and destroy instance.
  *
@@ -17,13 +17,21 @@
 
 #pragma once
 #include "../common.h"
+#include <stdio.h>
+
+void SAU_put_WAVHeader(FILE *restrict f,
+		uint16_t channels, uint32_t srate, uint32_t samples);
 
 struct SAU_WAVFile;
 typedef struct SAU_WAVFile SAU_WAVFile;
 
 SAU_WAVFile *SAU_create_WAVFile(const char *restrict fpath,
 		uint16_t channels, uint32_t srate) sauMalloclike;
+SAU_WAVFile *SAU_resume_WAVFile(const char *restrict fpath,
+		uint16_t channels, uint32_t srate,
+		uint32_t samples) sauMalloclike;
 int SAU_close_WAVFile(SAU_WAVFile *restrict o);
 
 bool SAU_WAVFile_write(SAU_WAVFile *restrict o,
 		const int16_t *restrict buf, uint32_t samples);
+bool SAU_WAVFile_flush(SAU_WAVFile *restrict o);
@@ -15,6 +15,8 @@
 #include "time.h"
 #include "ramp.h"
 #include "wave.h"
+#include <stdio.h>
+#include <string.h>
 
 /*
  * Program types and definitions.
@@ -41,7 +43,8 @@ enum {
 	SAU_POPP_PHASE = 1<<5,
 	SAU_POPP_AMP = 1<<6,
 	SAU_POPP_AMP2 = 1<<7,
-	SAU_POP_PARAMS = (1<<8) - 1
+	SAU_POP_PARAMS = (1<<8) - 1,
+	SAU_POPF_MUTE = 1<<8, // output zero for lifetime; skip running
 };
 
 /*
@@ -85,21 +88,104 @@ typedef struct SAU_ProgramVoData {
 	const struct SAU_ProgramVoData *prev;
 } SAU_ProgramVoData;
 
+/**
+ * Operator data for an event. Only the values for parameters set in
+ * \a params are stored, packed after the struct in the order of the
+ * SAU_POPP_* flags; get them using SAU_ProgramOpData_VALUE(). The time
+ * is the exception, kept for all as the operator's duration.
+ *
+ * The size varies with \a params, so the data for an event is stepped
+ * through using SAU_ProgramOpData_next().
+ */
 typedef struct SAU_ProgramOpData {
 	const SAU_ProgramOpList *fmods;
 	const SAU_ProgramOpList *pmods;
 	const SAU_ProgramOpList *amods;
+	const struct SAU_ProgramOpData *prev; /* NULL for new operator */
 	uint32_t id;
 	uint32_t params;
 	SAU_Time time;
-	uint32_t silence_ms;
-	uint8_t wave;
-	SAU_Ramp freq, freq2;
-	SAU_Ramp amp, amp2;
-	float phase;
-	const struct SAU_ProgramOpData *prev;
+	uint8_t values[];
 } SAU_ProgramOpData;
 
+/*
+ * Sizes of operator parameter values stored. Wave type (uint32_t),
+ * silence time (uint32_t), and phase (float) use a word each.
+ */
+#define SAU_POPV_WORD_SIZE sizeof(uint32_t)
+#define SAU_POPV_RAMP_SIZE sizeof(SAU_Ramp)
+
+/**
+ * Get offset of the value for parameter flag \p param,
+ * among the values stored for the flags in \p params.
+ */
+static inline size_t SAU_ProgramOpData_offs(uint32_t params, uint32_t param) {
+	params &= param - 1;
+	return ((params & SAU_POPP_WAVE) ? SAU_POPV_WORD_SIZE : 0) +
+		((params & SAU_POPP_SILENCE) ? SAU_POPV_WORD_SIZE : 0) +
+		((params & SAU_POPP_FREQ) ? SAU_POPV_RAMP_SIZE : 0) +
+		((params & SAU_POPP_FREQ2) ? SAU_POPV_RAMP_SIZE : 0) +
+		((params & SAU_POPP_PHASE) ? SAU_POPV_WORD_SIZE : 0) +
+		((params & SAU_POPP_AMP) ? SAU_POPV_RAMP_SIZE : 0) +
+		((params & SAU_POPP_AMP2) ? SAU_POPV_RAMP_SIZE : 0);
+}
+
+/**
+ * Get size of the values stored for the flags in \p params.
+ */
+#define SAU_POPV_SIZE(params) \
+	SAU_ProgramOpData_offs((params), SAU_POP_PARAMS + 1)
+
+/**
+ * Get pointer to value for parameter flag \p param among \p values
+ * stored for the flags in \p params, valid only if the flag is set.
+ */
+#define SAU_POPV_AT(values, params, param) \
+	((values) + SAU_ProgramOpData_offs((params), (param)))
+
+/**
+ * Copy the values for the flags in \p params to \p dst, from \p src
+ * holding the values for \p src_params, which must include them.
+ */
+static inline void SAU_POPV_copy(uint8_t *restrict dst, uint32_t params,
+		const uint8_t *restrict src, uint32_t src_params) {
+	for (uint32_t param = 1; param <= SAU_POPP_AMP2; param <<= 1) {
+		if (!(src_params & param))
+			continue;
+		size_t size = SAU_POPV_SIZE(param);
+		if (params & param) {
+			memcpy(dst, src, size);
+			dst += size;
+		}
+		src += size;
+	}
+}
+
+/**
+ * Get size of operator data with values for the flags in \p params,
+ * padded for the alignment of the next.
+ */
+static inline size_t SAU_ProgramOpData_size(uint32_t params) {
+	size_t size = sizeof(SAU_ProgramOpData) + SAU_POPV_SIZE(params);
+	return (size + (sizeof(void*) - 1)) & ~(sizeof(void*) - 1);
+}
+
+/**
+ * Get operator data following \p od for the same event.
+ */
+static inline const SAU_ProgramOpData
+*SAU_ProgramOpData_next(const SAU_ProgramOpData *restrict od) {
+	return (const SAU_ProgramOpData*) ((const uint8_t*) od +
+			SAU_ProgramOpData_size(od->params));
+}
+
+/**
+ * Get pointer to value for parameter flag \p param in \p od,
+ * valid only if the flag is set.
+ */
+#define SAU_ProgramOpData_VALUE(od, param) \
+	SAU_POPV_AT((od)->values, (od)->params, (param))
+
 typedef struct SAU_ProgramEvent {
 	uint32_t wait_ms;
 	uint16_t vo_id;
@@ -121,19 +207,45 @@ struct SAU_MemPool;
  * Main program type. Contains everything needed for interpretation.
  */
 typedef struct SAU_Program {
-	const SAU_ProgramEvent **events;
+	const SAU_ProgramEvent *events;
 	size_t ev_count;
 	uint16_t mode;
 	uint16_t vo_count;
 	uint32_t op_count;
+	uint32_t op_list_count; // unique lists stored
+	uint32_t op_list_uses; // lists assigned, sharing storage
+	uint32_t ev_merged; // same-time events merged into earlier ones
+	uint32_t params_pruned; // updates removed for changing nothing
+	uint32_t ops_unused; // operators removed for never being used
+	uint32_t ops_muted; // operators marked for never being audible
 	uint32_t duration_ms;
 	const char *name;
+	const char *msgs; // printed when built, for reuse from file; or NULL
 	struct SAU_MemPool *mem; // internally used, provided until destroy
 } SAU_Program;
 
 struct SAU_Script;
 SAU_Program* SAU_build_Program(struct SAU_Script *restrict sd) sauMalloclike;
 void SAU_discard_Program(SAU_Program *restrict o);
+SAU_Program *SAU_load_Program(const char *restrict script_arg,
+		bool is_path) sauMalloclike;
+
+/**
+ * Identity of the script contents a program was built from, stored
+ * in program files and checked when reading one back: the length,
+ * and two different 64-bit hashes of the contents.
+ */
+typedef struct SAU_ProgramSrcKey {
+	uint64_t len;
+	uint64_t hash;
+	uint64_t check;
+} SAU_ProgramSrcKey;
+
+bool SAU_Program_write(const SAU_Program *restrict o,
+		const SAU_ProgramSrcKey *restrict key, FILE *restrict f);
+SAU_Program *SAU_read_Program(FILE *restrict f,
+		const SAU_ProgramSrcKey *restrict key,
+		const char *restrict name) sauMalloclike;
 
 void SAU_Program_print_info(const SAU_Program *restrict o,
 		const char *restrict name_prefix,
@@ -15,11 +15,15 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include "file.h"
 #include "../math.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /**
  * Default callback. Moves through the circular buffer in
@@ -32,12 +36,14 @@
  *
  * If set, instead calls SAU_File_end(), writing out the
  * end marker to the current character in the buffer and
- * increasing the wrapped position by one.
+ * increasing the wrapped position by one. For a mapped
+ * file, the position is first moved back to the marker.
  *
  * \return call position difference in clear case, or 0
  */
 size_t SAU_File_action_wrap(SAU_File *restrict o) {
 	if (o->status & SAU_FILE_END) {
+		if (o->map != NULL) o->pos = o->end_pos;
 		SAU_File_end(o, 0, false); // repeat end marker
 		return 0;
 	}
@@ -47,6 +53,19 @@ size_t SAU_File_action_wrap(SAU_File *restrict o) {
 	return len;
 }
 
+/*
+ * Unmap file if mapped, returning to use of the buffer.
+ */
+static void unmap(SAU_File *restrict o) {
+	if (o->map != NULL) {
+		munmap(o->map, o->map_len);
+		o->map = NULL;
+		o->map_len = 0;
+	}
+	o->buf = o->buf_area;
+	o->mask = SAU_FILE_BUFSIZ - 1;
+}
+
 /**
  * Reset all state other than buffer contents.
  * Used for opening and closing.
@@ -55,6 +74,7 @@ void SAU_File_init(SAU_File *restrict o,
 		SAU_FileAction_f call_f, void *restrict ref,
 		const char *path, SAU_FileClose_f close_f) {
 	if (o->close_f != NULL) o->close_f(o);
+	unmap(o);
 
 	o->pos = 0;
 	o->call_pos = 0;
@@ -100,20 +120,56 @@ SAU_File *SAU_destroy_File(SAU_File *restrict o) {
 		return NULL;
 
 	if (o->close_f != NULL) o->close_f(o);
+	unmap(o);
 	SAU_File *parent = o->parent;
 	free(o);
 	return parent;
 }
 
 static size_t mode_fread(SAU_File *restrict o);
+static size_t mode_mapread(SAU_File *restrict o);
 static size_t mode_strread(SAU_File *restrict o);
 
 static void ref_fclose(SAU_File *restrict o);
 
+/*
+ * Map regular file \p f privately, for reading it in place.
+ * Only done if the last page has room for the end marker.
+ *
+ * \return true if mapped and opened, false if to be read instead
+ */
+static bool try_map(SAU_File *restrict o, FILE *restrict f,
+		const char *restrict path) {
+	struct stat st;
+	long page_size = sysconf(_SC_PAGESIZE);
+	int fd = fileno(f);
+	if (fd < 0 || page_size <= 0 || fstat(fd, &st) != 0 ||
+			!S_ISREG(st.st_mode) || st.st_size <= 0 ||
+			(uintmax_t) st.st_size >= SIZE_MAX ||
+			(st.st_size % page_size) == 0)
+		return false;
+	size_t len = st.st_size;
+	void *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+			fd, 0);
+	if (map == MAP_FAILED)
+		return false;
+	fclose(f);
+	SAU_File_init(o, mode_mapread, NULL, path, NULL);
+	o->map = map;
+	o->map_len = len;
+	o->buf = map;
+	o->mask = SIZE_MAX;
+	o->call_pos = len;
+	return true;
+}
+
 /**
  * Open stdio file for reading.
  * (If a file was already opened, it is closed on success.)
  *
+ * A regular file is memory-mapped when possible, and otherwise
+ * read into the buffer, as is done for pipes and the like.
+ *
  * The file is automatically closed when EOF or a read error occurs,
  * but \a path is only cleared with a new open call or a call
  * to SAU_File_reset(), so as to remain available for printing.
@@ -126,6 +182,8 @@ bool SAU_File_fopenrb(SAU_File *restrict o, const char *restrict path) {
 	FILE *f = fopen(path, "rb");
 	if (!f)
 		return false;
+	if (try_map(o, f, path))
+		return true;
 	SAU_File_init(o, mode_fread, f, path, ref_fclose);
 	return true;
 }
@@ -149,6 +207,28 @@ bool SAU_File_stropenrb(SAU_File *restrict o,
 	return true;
 }
 
+/**
+ * Get the next span of the contents of a file opened for reading,
+ * for reading it through in spans instead of by character. A mapped
+ * file is got whole and in place, others a buffer area at a time.
+ *
+ * \return length of span, or 0 when at the end
+ */
+size_t SAU_File_getspan(SAU_File *restrict o,
+		const uint8_t **restrict span) {
+	if (o->status & SAU_FILE_END)
+		return 0;
+	if (o->map != NULL) {
+		*span = o->map;
+		o->call_f(o); // reach end
+		return o->map_len;
+	}
+	o->pos = o->call_pos;
+	size_t len = o->call_f(o);
+	*span = &o->buf[o->pos];
+	return len;
+}
+
 /**
  * Close and clear internal reference if open. Sets SAU_FILE_END status
  * and restores the callback to SAU_File_action_wrap(). If there is a
@@ -170,7 +250,7 @@ void SAU_File_close(SAU_File *restrict o) {
 		o->close_f = NULL;
 	}
 	o->ref = NULL;
-	o->call_pos = (o->pos + 1) & (SAU_FILE_BUFSIZ - 1);
+	o->call_pos = (o->pos + 1) & o->mask;
 	o->call_f = SAU_File_action_wrap;
 }
 
@@ -180,7 +260,7 @@ void SAU_File_close(SAU_File *restrict o) {
  */
 void SAU_File_reset(SAU_File *restrict o) {
 	SAU_File_init(o, SAU_File_action_wrap, NULL, NULL, NULL);
-	memset(o->buf, 0, SAU_FILE_BUFSIZ);
+	memset(o->buf_area, 0, SAU_FILE_BUFSIZ);
 }
 
 /**
@@ -201,9 +281,9 @@ void SAU_File_end(SAU_File *restrict o, size_t keep_len, bool error) {
 	SAU_File_close(o);
 	if (error)
 		o->status |= SAU_FILE_ERROR;
-	o->end_pos = (o->pos + keep_len) & (SAU_FILE_BUFSIZ - 1);
+	o->end_pos = (o->pos + keep_len) & o->mask;
 	o->buf[o->end_pos] = o->status;
-	o->call_pos = (o->end_pos + 1) & (SAU_FILE_BUFSIZ - 1);
+	o->call_pos = (o->end_pos + 1) & o->mask;
 }
 
 /*
@@ -228,6 +308,19 @@ static size_t mode_fread(SAU_File *restrict o) {
 	return len;
 }
 
+/*
+ * Reach the end of a mapped file, which is read in place.
+ * Inserts SAU_File_STATUS() value as an end marker after
+ * the file contents, in the remainder of the last page.
+ *
+ * \return 0
+ */
+static size_t mode_mapread(SAU_File *restrict o) {
+	o->pos = o->map_len;
+	SAU_File_end(o, 0, false);
+	return 0;
+}
+
 /*
  * Read up to a buffer area of data from a string, advancing
  * the pointer, unless the string is NULL. Closes file
@@ -271,6 +364,80 @@ static void ref_fclose(SAU_File *restrict o) {
 #define IS_LNBRK(c) ((c) == '\n' || (c) == '\r')
 #define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
 
+/*
+ * Word-at-a-time byte tests, for skipping over runs of characters.
+ * WORD_HAS_LESS() is true if any byte is less than \p n (<= 128).
+ */
+#define WORD_ONES  ((size_t) -1 / 0xFF)
+#define WORD_HIGHS (WORD_ONES * 0x80)
+#define WORD_HAS_LESS(w, n) (((w) - WORD_ONES * (n)) & ~(w) & WORD_HIGHS)
+#define WORD_HAS_ZERO(w) WORD_HAS_LESS(w, 1)
+
+/*
+ * Get length of buffer contents from the current position which
+ * can be read without calling the callback or wrapping position.
+ * Calls the callback first if at the call position.
+ */
+static size_t get_span(SAU_File *restrict o) {
+	SAU_File_UPDATE(o);
+	size_t len = SAU_File_CREM(o);
+	size_t rem = o->mask - o->pos;
+	if (len > rem) len = rem + 1;
+	return len;
+}
+
+/*
+ * Get length of run of spaces and tabs in \p s, up to \p len.
+ */
+static size_t span_space(const uint8_t *restrict s, size_t len) {
+	const size_t spaces = WORD_ONES * ' ';
+	size_t i = 0;
+	for (;;) {
+		size_t end = len;
+		if (len - i >= sizeof(size_t)) {
+			size_t w;
+			memcpy(&w, &s[i], sizeof(w));
+			if (w == spaces) {
+				i += sizeof(size_t);
+				continue;
+			}
+			end = i + sizeof(size_t);
+		}
+		for (; i < end; ++i)
+			if (!IS_SPACE(s[i])) return i;
+		if (i == len) return i;
+	}
+}
+
+/*
+ * Get length of run of characters in \p s, up to \p len, before
+ * the first linebreak, possible end marker, or \p stop_c.
+ */
+static size_t span_line(const uint8_t *restrict s, size_t len,
+		uint8_t stop_c) {
+	const size_t stops = WORD_ONES * stop_c;
+	size_t i = 0;
+	for (;;) {
+		size_t end = len;
+		if (len - i >= sizeof(size_t)) {
+			size_t w;
+			memcpy(&w, &s[i], sizeof(w));
+			if (!WORD_HAS_LESS(w, '\r' + 1) &&
+			    !WORD_HAS_ZERO(w ^ stops)) {
+				i += sizeof(size_t);
+				continue;
+			}
+			end = i + sizeof(size_t);
+		}
+		for (; i < end; ++i) {
+			uint8_t c = s[i];
+			if (IS_LNBRK(c) || c <= SAU_FILE_MARKER || c == stop_c)
+				return i;
+		}
+		if (i == len) return i;
+	}
+}
+
 /**
  * Read characters into \p buf. At most \p buf_len - 1 characters
  * are read, and the string is always NULL-terminated.
@@ -375,6 +542,24 @@ bool SAU_File_geti(SAU_File *restrict o,
 	return !truncate;
 }
 
+/*
+ * Exact powers of ten for double conversion.
+ */
+static const double pow10_exact[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+	1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+	1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+#define POW10_EXACT_MAX 22
+#define MANT_EXACT_MAX  (UINT64_C(1) << 53)
+
+/*
+ * Significant digits kept for text conversion, beyond the exact case.
+ * More than the 767 a double or halfway point between doubles may need,
+ * so that one digit standing for those dropped keeps rounding correct.
+ */
+#define GETD_DIGITS_MAX 800
+
 /**
  * Read double-precision floating point number into \p var.
  *
@@ -382,6 +567,12 @@ bool SAU_File_geti(SAU_File *restrict o,
  * The number sub-string must have the form:
  * optional sign, then digits and/or point followed by digits.
  *
+ * Digits are read in one pass, collecting an integer mantissa
+ * and a decimal exponent. The result is correctly rounded: it's
+ * computed exactly in double precision when both the mantissa
+ * and power of ten are exactly representable, as is normal for
+ * short literals; otherwise, the digits are converted by strtod().
+ *
  * If \p lenp is not NULL, it will be set to the number of characters
  * read. 0 implies that no number was read and that \p var is unchanged.
  *
@@ -390,11 +581,16 @@ bool SAU_File_geti(SAU_File *restrict o,
 bool SAU_File_getd(SAU_File *restrict o,
 		double *restrict var, bool allow_sign,
 		size_t *restrict lenp) {
+	char digits[GETD_DIGITS_MAX + 32];
+	size_t ndigits = 0;
+	uint64_t mant = 0;
+	int32_t exp10 = 0;
 	uint8_t c;
-	long double num = 0.f, pos_mul = 1.f;
 	double res;
 	bool minus = false;
 	bool truncate = false;
+	bool has_int = false;
+	bool dropped = false;
 	size_t len = 0;
 	c = SAU_File_GETC(o);
 	++len;
@@ -403,37 +599,71 @@ bool SAU_File_getd(SAU_File *restrict o,
 		c = SAU_File_GETC(o);
 		++len;
 	}
-	if (c != '.') {
-		if (!IS_DIGIT(c)) {
-			SAU_File_UNGETN(o, len);
-			if (lenp) *lenp = 0;
-			return true;
+	/*
+	 * Leading zeros are skipped, so that they don't count
+	 * as significant digits; digits beyond those kept only
+	 * scale the result (before the point) or are dropped,
+	 * noting whether any dropped is non-zero.
+	 */
+	while (IS_DIGIT(c)) {
+		has_int = true;
+		if (ndigits > 0 || c != '0') {
+			if (ndigits < GETD_DIGITS_MAX) {
+				digits[ndigits++] = c;
+				mant = mant * 10 + (c - '0');
+			} else {
+				++exp10;
+				if (c != '0') dropped = true;
+			}
 		}
-		do {
-			num = num * 10.f + (c - '0');
-			c = SAU_File_GETC(o);
-			++len;
-		} while (IS_DIGIT(c));
-		if (c != '.') goto DONE;
 		c = SAU_File_GETC(o);
 		++len;
-	} else {
+	}
+	if (c == '.') {
 		c = SAU_File_GETC(o);
 		++len;
-		if (!IS_DIGIT(c)) {
+		if (!has_int && !IS_DIGIT(c)) {
 			SAU_File_UNGETN(o, len);
 			if (lenp) *lenp = 0;
 			return true;
 		}
+		while (IS_DIGIT(c)) {
+			if (ndigits > 0 || c != '0') {
+				if (ndigits < GETD_DIGITS_MAX) {
+					digits[ndigits++] = c;
+					mant = mant * 10 + (c - '0');
+					--exp10;
+				} else if (c != '0') {
+					dropped = true;
+				}
+			} else {
+				--exp10;
+			}
+			c = SAU_File_GETC(o);
+			++len;
+		}
+	} else if (!has_int) {
+		SAU_File_UNGETN(o, len);
+		if (lenp) *lenp = 0;
+		return true;
 	}
-	while (IS_DIGIT(c)) {
-		pos_mul *= 0.1f;
-		num += (c - '0') * pos_mul;
-		c = SAU_File_GETC(o);
-		++len;
+	if (ndigits == 0) {
+		res = 0.0;
+	} else if (ndigits <= 19 && mant <= MANT_EXACT_MAX &&
+			exp10 >= -POW10_EXACT_MAX && exp10 <= POW10_EXACT_MAX) {
+		res = (exp10 < 0) ?
+			(double) mant / pow10_exact[-exp10] :
+			(double) mant * pow10_exact[exp10];
+	} else {
+		if (dropped) {
+			/* place a non-zero digit after those kept */
+			digits[ndigits++] = '1';
+			--exp10;
+		}
+		snprintf(&digits[ndigits], sizeof(digits) - ndigits,
+				"e%ld", (long) exp10);
+		res = strtod(digits, NULL);
 	}
-DONE:
-	res = (double) num;
 	if (isinf(res)) truncate = true;
 	if (minus) res = -res;
 	*var = res;
@@ -467,27 +697,44 @@ size_t SAU_File_skipstr(SAU_File *restrict o, SAU_FileFilter_f filter_f) {
 size_t SAU_File_skipspace(SAU_File *restrict o) {
 	size_t i = 0;
 	for (;;) {
-		uint8_t c = SAU_File_GETC(o);
-		if (!IS_SPACE(c)) break;
-		++i;
+		size_t len = get_span(o);
+		size_t n = span_space(&o->buf[o->pos], len);
+		o->pos += n;
+		i += n;
+		if (n < len) break;
 	}
-	SAU_File_DECP(o);
 	return i;
 }
 
 /**
- * Advance past characters until the next marks the end of the line (or file).
+ * Advance past characters until the next is \p c,
+ * or marks the end of the line (or file).
  *
  * \return number of characters skipped
  */
-size_t SAU_File_skipline(SAU_File *restrict o) {
+size_t SAU_File_skipto(SAU_File *restrict o, uint8_t c) {
 	size_t i = 0;
 	for (;;) {
-		uint8_t c = SAU_File_GETC(o);
-		if (IS_LNBRK(c) ||
-			(c <= SAU_FILE_MARKER && SAU_File_AFTER_EOF(o))) break;
-		++i;
+		size_t len = get_span(o);
+		size_t n = span_line(&o->buf[o->pos], len, c);
+		o->pos += n;
+		i += n;
+		if (n < len) {
+			uint8_t next_c = o->buf[o->pos];
+			if (next_c > SAU_FILE_MARKER || SAU_File_AT_EOF(o))
+				break;
+			++o->pos; // not the end marker
+			++i;
+		}
 	}
-	SAU_File_DECP(o);
 	return i;
 }
+
+/**
+ * Advance past characters until the next marks the end of the line (or file).
+ *
+ * \return number of characters skipped
+ */
+size_t SAU_File_skipline(SAU_File *restrict o) {
+	return SAU_File_skipto(o, '\n');
+}
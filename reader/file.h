@@ -77,7 +77,7 @@ size_t SAU_File_action_wrap(SAU_File *restrict o); // default & EOF'd callback
  * \return length
  */
 #define SAU_File_BREM(o) \
-	((SAU_FILE_BUFSIZ - 1) - ((o)->pos & (SAU_FILE_BUFSIZ - 1)))
+	((o)->mask - ((o)->pos & (o)->mask))
 
 /**
  * True if at call position, prior to calling callback.
@@ -96,7 +96,7 @@ size_t SAU_File_action_wrap(SAU_File *restrict o); // default & EOF'd callback
  * \return length
  */
 #define SAU_File_CREM(o) \
-	(((o)->call_pos - (o)->pos) & (SAU_FILE_BUFSIZ - 1))
+	(((o)->call_pos - (o)->pos) & (o)->mask)
 
 /**
  * Increment position without limiting it to the buffer boundary.
@@ -123,7 +123,7 @@ size_t SAU_File_action_wrap(SAU_File *restrict o); // default & EOF'd callback
  *
  * \return new position
  */
-#define SAU_File_FIXP(o) ((o)->pos &= SAU_FILE_BUFSIZ - 1)
+#define SAU_File_FIXP(o) ((o)->pos &= (o)->mask)
 
 /**
  * File reading status constants.
@@ -160,10 +160,17 @@ typedef void (*SAU_FileClose_f)(SAU_File *restrict o);
  * The default callback simply increases and wraps the call position.
  * Opening a file for reading sets a callback to fill the buffer
  * one area at a time.
+ *
+ * A regular file may instead be memory-mapped, the buffer then being
+ * the whole file, which positions don't wrap within (\a mask is all
+ * ones). The mapping is kept until re-opening or destruction, so that
+ * the end marker remains readable after closing.
  */
 struct SAU_File {
 	size_t pos;
 	size_t call_pos;
+	size_t mask;
+	uint8_t *buf;
 	SAU_FileAction_f call_f;
 	uint8_t status;
 	size_t end_pos;
@@ -171,7 +178,9 @@ struct SAU_File {
 	const char *path;
 	SAU_File *parent;
 	SAU_FileClose_f close_f;
-	uint8_t buf[SAU_FILE_BUFSIZ];
+	void *map;
+	size_t map_len;
+	uint8_t buf_area[SAU_FILE_BUFSIZ];
 };
 
 SAU_File *SAU_create_File(void) sauMalloclike;
@@ -185,6 +194,8 @@ void SAU_File_init(SAU_File *restrict o,
 bool SAU_File_fopenrb(SAU_File *restrict o, const char *restrict path);
 bool SAU_File_stropenrb(SAU_File *restrict o,
 		const char *restrict path, const char *restrict str);
+size_t SAU_File_getspan(SAU_File *restrict o,
+		const uint8_t **restrict span);
 
 void SAU_File_close(SAU_File *restrict o);
 void SAU_File_reset(SAU_File *restrict o);
@@ -249,7 +260,7 @@ void SAU_File_end(SAU_File *restrict o, size_t keep_len, bool error);
  * \return new position
  */
 #define SAU_File_UNGETC(o) \
-	((o)->pos = ((o)->pos - 1) & (SAU_FILE_BUFSIZ - 1))
+	((o)->pos = ((o)->pos - 1) & (o)->mask)
 
 /**
  * Compare current character to value \p c, without advancing position.
@@ -282,7 +293,7 @@ void SAU_File_end(SAU_File *restrict o, size_t keep_len, bool error);
  * \return new position
  */
 #define SAU_File_UNGETN(o, n) \
-	((o)->pos = ((o)->pos - (n)) & (SAU_FILE_BUFSIZ - 1))
+	((o)->pos = ((o)->pos - (n)) & (o)->mask)
 
 /**
  * Set current character, without advancing position.
@@ -345,7 +356,7 @@ void SAU_File_end(SAU_File *restrict o, size_t keep_len, bool error);
  * before handling the situation.
  */
 #define SAU_File_AFTER_EOF(o) \
-	((o)->end_pos == (((o)->pos - 1) & (SAU_FILE_BUFSIZ - 1)))
+	((o)->end_pos == (((o)->pos - 1) & (o)->mask))
 
 /**
  * Get newline in portable way, advancing position if newline read.
@@ -383,4 +394,5 @@ bool SAU_File_getd(SAU_File *restrict o,
 		size_t *restrict lenp);
 size_t SAU_File_skipstr(SAU_File *restrict o, SAU_FileFilter_f filter_f);
 size_t SAU_File_skipspace(SAU_File *restrict o);
+size_t SAU_File_skipto(SAU_File *restrict o, uint8_t c);
 size_t SAU_File_skipline(SAU_File *restrict o);
@@ -12,6 +12,7 @@
  */
 
 #include "parser.h"
+#include "../trace.h"
 
 /*
  * Script data construction from parse data.
@@ -59,10 +60,18 @@ static void time_durgroup(SAU_ParseEvData *restrict e_last) {
 		e_after->wait_ms += wait;
 }
 
-static inline void time_ramp(SAU_Ramp *restrict ramp,
-		uint32_t default_time_ms) {
+static inline void time_ramp(SAU_ParseOpData *restrict op, uint32_t param) {
+	if (!(op->op_params & param))
+		return;
+	SAU_Ramp *ramp = (SAU_Ramp*) SAU_ParseOpData_VALUE(op, param);
 	if (!(ramp->flags & SAU_RAMPP_TIME))
-		ramp->time_ms = default_time_ms;
+		ramp->time_ms = op->time.v_ms;
+}
+
+static inline uint32_t get_silence_ms(const SAU_ParseOpData *restrict op) {
+	if (!(op->op_params & SAU_POPP_SILENCE))
+		return 0;
+	return *(uint32_t*) SAU_ParseOpData_VALUE(op, SAU_POPP_SILENCE);
 }
 
 static void time_operator(SAU_ParseOpData *restrict op) {
@@ -74,12 +83,12 @@ static void time_operator(SAU_ParseOpData *restrict op) {
 		op->time.flags |= SAU_TIMEP_SET;
 	}
 	if (!(op->time.flags & SAU_TIMEP_LINKED)) {
-		time_ramp(&op->freq, op->time.v_ms);
-		time_ramp(&op->freq2, op->time.v_ms);
-		time_ramp(&op->amp, op->time.v_ms);
-		time_ramp(&op->amp2, op->time.v_ms);
+		time_ramp(op, SAU_POPP_FREQ);
+		time_ramp(op, SAU_POPP_FREQ2);
+		time_ramp(op, SAU_POPP_AMP);
+		time_ramp(op, SAU_POPP_AMP2);
 		if (!(op->op_flags & SAU_PDOP_SILENCE_ADDED)) {
-			op->time.v_ms += op->silence_ms;
+			op->time.v_ms += get_silence_ms(op);
 			op->op_flags |= SAU_PDOP_SILENCE_ADDED;
 		}
 	}
@@ -127,7 +136,7 @@ static void time_event(SAU_ParseEvData *restrict e) {
 					ce_op->time.flags |= SAU_TIMEP_LINKED;
 				else
 					ce_op->time.v_ms = ce_op_prev->time.v_ms
-						- ce_op_prev->silence_ms;
+						- get_silence_ms(ce_op_prev);
 			}
 			time_event(ce);
 			if (ce_op->time.flags & SAU_TIMEP_LINKED)
@@ -273,8 +282,9 @@ typedef struct VoContext {
  */
 static bool ParseConv_add_opdata(ParseConv *restrict o,
 		SAU_ParseOpData *restrict pod) {
+	size_t values_size = SAU_POPV_SIZE(pod->op_params);
 	SAU_ScriptOpData *od = SAU_MemPool_alloc(o->mem,
-			sizeof(SAU_ScriptOpData));
+			offsetof(SAU_ScriptOpData, values) + values_size);
 	if (!od) goto ERROR;
 	SAU_ScriptEvData *e = o->ev;
 	pod->op_conv = od;
@@ -283,13 +293,7 @@ static bool ParseConv_add_opdata(ParseConv *restrict o,
 	/* op_flags */
 	od->op_params = pod->op_params;
 	od->time = pod->time;
-	od->silence_ms = pod->silence_ms;
-	od->wave = pod->wave;
-	od->freq = pod->freq;
-	od->freq2 = pod->freq2;
-	od->amp = pod->amp;
-	od->amp2 = pod->amp2;
-	od->phase = pod->phase;
+	memcpy(od->values, pod->values, values_size);
 	if (!ParseConv_update_opcontext(o, od, pod)) goto ERROR;
 	if (!e->op_all.first)
 		e->op_all.first = od;
@@ -430,12 +434,17 @@ static SAU_Script *ParseConv_convert(ParseConv *restrict o,
 		time_event(pe);
 		if (pe == pe->dur->range.last) time_durgroup(pe);
 	}
-	o->mem = SAU_create_MemPool(0);
+	o->mem = SAU_obtain_MemPool(0);
 	o->tmp = p->mem;
 	if (!o->mem || !o->tmp) goto ERROR;
 	SAU_Script *s = SAU_MemPool_alloc(o->mem, sizeof(SAU_Script));
 	if (!s) goto ERROR;
 	s->name = p->name;
+	if (p->msgs != NULL) {
+		s->msgs = SAU_MemPool_memdup(o->mem, p->msgs,
+				strlen(p->msgs) + 1);
+		if (!s->msgs) goto ERROR;
+	}
 	s->sopt = p->sopt;
 	s->mem = o->mem;
 	/*
@@ -450,25 +459,42 @@ static SAU_Script *ParseConv_convert(ParseConv *restrict o,
 	s->events = o->first_ev;
 	if (false)
 	ERROR: {
-		SAU_destroy_MemPool(o->mem);
+		SAU_release_MemPool(o->mem);
 		SAU_error("parseconv", "memory allocation failure");
 		s = NULL;
 	}
 	return s;
 }
 
+/**
+ * Create script data from parse data \p p, which is modified
+ * in the process and only to be destroyed afterwards.
+ *
+ * \return instance or NULL on error
+ */
+SAU_Script *SAU_build_Script(SAU_Parse *restrict p) {
+	ParseConv pc = (ParseConv){0};
+	SAU_Script *o = ParseConv_convert(&pc, p);
+	if (o != NULL) SAU_MemPool_get_stats(p->mem, &o->parse_mem);
+	return o;
+}
+
 /**
  * Create script data for the given script. Invokes the parser.
  *
  * \return instance or NULL on error
  */
 SAU_Script *SAU_load_Script(const char *restrict script_arg, bool is_path) {
-	ParseConv pc = (ParseConv){0};
+	const char *label = is_path ? script_arg : NULL;
+	uint64_t t = SAU_Trace_begin();
 	SAU_Parse *p = SAU_create_Parse(script_arg, is_path);
+	SAU_Trace_end(t, "build", "parse", label);
 	if (!p)
 		return NULL;
-	SAU_Script *o = ParseConv_convert(&pc, p);
+	t = SAU_Trace_begin();
+	SAU_Script *o = SAU_build_Script(p);
 	SAU_destroy_Parse(p);
+	SAU_Trace_end(t, "build", "parseconv", label);
 	return o;
 }
 
@@ -478,5 +504,5 @@ SAU_Script *SAU_load_Script(const char *restrict script_arg, bool is_path) {
 void SAU_discard_Script(SAU_Script *restrict o) {
 	if (!o)
 		return;
-	SAU_destroy_MemPool(o->mem);
+	SAU_release_MemPool(o->mem);
 }
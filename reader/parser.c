@@ -139,20 +139,33 @@ static double scan_num_r(NumParser *restrict o, uint8_t pri, uint32_t level) {
 	double num;
 	bool minus = false;
 	uint8_t c;
+	size_t read_len;
 	if (level == 1) SAU_Scanner_setws_level(sc, SAU_SCAN_WS_NONE);
-	c = SAU_Scanner_getc(sc);
-	if ((level > 0) && (c == '+' || c == '-')) {
-		if (c == '-') minus = true;
-		c = SAU_Scanner_getc(sc);
-	}
-	if (c == '(') {
-		num = scan_num_r(o, NUMEXP_SUB, level+1);
-	} else {
-		size_t read_len;
-		SAU_Scanner_ungetc(sc);
+	/*
+	 * Use quick handling for a plain literal, with nothing before it
+	 * to filter; otherwise, get the first character, then unget it
+	 * unless beginning a subexpression.
+	 */
+	c = SAU_File_RETC(sc->f);
+	if ((c >= '0' && c <= '9') || c == '.') {
 		SAU_Scanner_getd(sc, &num, false, &read_len, o->numconst_f);
 		if (read_len == 0)
 			return NAN;
+	} else {
+		c = SAU_Scanner_getc(sc);
+		if ((level > 0) && (c == '+' || c == '-')) {
+			if (c == '-') minus = true;
+			c = SAU_Scanner_getc(sc);
+		}
+		if (c == '(') {
+			num = scan_num_r(o, NUMEXP_SUB, level+1);
+		} else {
+			SAU_Scanner_ungetc(sc);
+			SAU_Scanner_getd(sc, &num, false, &read_len,
+					o->numconst_f);
+			if (read_len == 0)
+				return NAN;
+		}
 	}
 	if (isnan(num))
 		return NAN;
@@ -502,7 +515,7 @@ typedef struct SAU_Parser {
 static void fini_Parser(SAU_Parser *restrict o) {
 	SAU_destroy_Scanner(o->sc);
 	SAU_destroy_SymTab(o->st);
-	SAU_destroy_MemPool(o->mp);
+	SAU_release_MemPool(o->mp);
 }
 
 /*
@@ -514,7 +527,7 @@ static void fini_Parser(SAU_Parser *restrict o) {
  * \return true, or false on allocation failure
  */
 static bool init_Parser(SAU_Parser *restrict o) {
-	SAU_MemPool *mp = SAU_create_MemPool(0);
+	SAU_MemPool *mp = SAU_obtain_MemPool(0);
 	SAU_SymTab *st = SAU_create_SymTab(mp);
 	SAU_Scanner *sc = SAU_create_Scanner(st);
 	*o = (SAU_Parser){0};
@@ -558,6 +571,18 @@ enum {
 	PL_ACTIVE_OP     = 1<<4,
 };
 
+/*
+ * Operator parameter values, kept in full while parsing an operator,
+ * then packed for the parameters set into the node when it ends.
+ */
+typedef struct OpValues {
+	uint32_t wave;
+	uint32_t silence_ms;
+	SAU_Ramp freq, freq2;
+	float phase;
+	SAU_Ramp amp, amp2;
+} OpValues;
+
 /*
  * Things that need to be separate for each nested parse_level() go here.
  *
@@ -572,6 +597,8 @@ struct ParseLevel {
 	SAU_ParseEvData *event, *last_event;
 	SAU_ParseOpData *operator, *first_operator, *last_operator;
 	SAU_ParseOpData *parent_op, *op_prev;
+	OpValues *op_values; /* for operator, own or that of a parent level */
+	OpValues own_op_values;
 	SAU_ParseSublist *op_scope;
 	SAU_SymStr *set_label; /* label assigned to next node */
 	/* timing/delay */
@@ -621,6 +648,40 @@ static void new_durgroup(ParseLevel *restrict pl) {
 	o->cur_dur = dur;
 }
 
+/*
+ * Store the values for the parameters set in \p params, packed
+ * in the order of the flags.
+ */
+static void pack_op_values(uint8_t *restrict v, uint32_t params,
+		const OpValues *restrict ov) {
+	if (params & SAU_POPP_WAVE) {
+		*(uint32_t*) v = ov->wave;
+		v += SAU_POPV_WORD_SIZE;
+	}
+	if (params & SAU_POPP_SILENCE) {
+		*(uint32_t*) v = ov->silence_ms;
+		v += SAU_POPV_WORD_SIZE;
+	}
+	if (params & SAU_POPP_FREQ) {
+		*(SAU_Ramp*) v = ov->freq;
+		v += SAU_POPV_RAMP_SIZE;
+	}
+	if (params & SAU_POPP_FREQ2) {
+		*(SAU_Ramp*) v = ov->freq2;
+		v += SAU_POPV_RAMP_SIZE;
+	}
+	if (params & SAU_POPP_PHASE) {
+		*(float*) v = ov->phase;
+		v += SAU_POPV_WORD_SIZE;
+	}
+	if (params & SAU_POPP_AMP) {
+		*(SAU_Ramp*) v = ov->amp;
+		v += SAU_POPV_RAMP_SIZE;
+	}
+	if (params & SAU_POPP_AMP2)
+		*(SAU_Ramp*) v = ov->amp2;
+}
+
 static void end_operator(ParseLevel *restrict pl) {
 	if (!(pl->pl_flags & PL_ACTIVE_OP))
 		return;
@@ -628,16 +689,17 @@ static void end_operator(ParseLevel *restrict pl) {
 	SAU_Parser *o = pl->o;
 	ScanLookup *sl = &o->sl;
 	SAU_ParseOpData *op = pl->operator;
-	if (SAU_Ramp_ENABLED(&op->amp)) {
+	OpValues *ov = pl->op_values;
+	if (SAU_Ramp_ENABLED(&ov->amp)) {
 		if (!(op->op_flags & SAU_PDOP_NESTED)) {
-			op->amp.v0 *= sl->sopt.ampmult;
-			op->amp.vt *= sl->sopt.ampmult;
+			ov->amp.v0 *= sl->sopt.ampmult;
+			ov->amp.vt *= sl->sopt.ampmult;
 		}
 	}
-	if (SAU_Ramp_ENABLED(&op->amp2)) {
+	if (SAU_Ramp_ENABLED(&ov->amp2)) {
 		if (!(op->op_flags & SAU_PDOP_NESTED)) {
-			op->amp2.v0 *= sl->sopt.ampmult;
-			op->amp2.vt *= sl->sopt.ampmult;
+			ov->amp2.v0 *= sl->sopt.ampmult;
+			ov->amp2.vt *= sl->sopt.ampmult;
 		}
 	}
 	SAU_ParseOpData *pop = op->prev;
@@ -647,7 +709,10 @@ static void end_operator(ParseLevel *restrict pl) {
 		 */
 		op->op_params |= SAU_POP_PARAMS;
 	}
+	op->values = SAU_MemPool_alloc(o->mp, SAU_POPV_SIZE(op->op_params));
+	pack_op_values(op->values, op->op_params, ov);
 	pl->operator = NULL;
+	pl->op_values = NULL;
 	pl->last_operator = op;
 }
 
@@ -724,7 +789,9 @@ static void begin_operator(ParseLevel *restrict pl,
 	 */
 	end_operator(pl);
 	SAU_ParseOpData *op = SAU_MemPool_alloc(o->mp, sizeof(SAU_ParseOpData));
+	OpValues *ov = &pl->own_op_values;
 	pl->operator = op;
+	pl->op_values = ov;
 	if (!pl->first_operator)
 		pl->first_operator = op;
 	if (!is_composite && pl->last_operator != NULL)
@@ -733,10 +800,11 @@ static void begin_operator(ParseLevel *restrict pl,
 	 * Initialize node.
 	 */
 	op->time.v_ms = sl->sopt.def_time_ms; /* time is not copied */
-	SAU_Ramp_reset(&op->freq);
-	SAU_Ramp_reset(&op->freq2);
-	SAU_Ramp_reset(&op->amp);
-	SAU_Ramp_reset(&op->amp2);
+	*ov = (OpValues){0};
+	SAU_Ramp_reset(&ov->freq);
+	SAU_Ramp_reset(&ov->freq2);
+	SAU_Ramp_reset(&ov->amp);
+	SAU_Ramp_reset(&ov->amp2);
 	if (pop != NULL) {
 		op->use_type = pop->use_type;
 		op->prev = pop;
@@ -766,15 +834,15 @@ static void begin_operator(ParseLevel *restrict pl,
 				pl->op_scope->use_type :
 				SAU_POP_CARR;
 		if (op->use_type == SAU_POP_CARR) {
-			op->freq.v0 = sl->sopt.def_freq;
+			ov->freq.v0 = sl->sopt.def_freq;
 		} else {
 			op->op_flags |= SAU_PDOP_NESTED;
-			op->freq.v0 = sl->sopt.def_relfreq;
-			op->freq.flags |= SAU_RAMPP_STATE_RATIO;
+			ov->freq.v0 = sl->sopt.def_relfreq;
+			ov->freq.flags |= SAU_RAMPP_STATE_RATIO;
 		}
-		op->freq.flags |= SAU_RAMPP_STATE;
-		op->amp.v0 = 1.0f;
-		op->amp.flags |= SAU_RAMPP_STATE;
+		ov->freq.flags |= SAU_RAMPP_STATE;
+		ov->amp.v0 = 1.0f;
+		ov->amp.flags |= SAU_RAMPP_STATE;
 	}
 	op->event = e;
 	/*
@@ -844,6 +912,7 @@ static void begin_scope(SAU_Parser *restrict o, ParseLevel *restrict pl,
 	pl->sub_f = parent_pl->sub_f;
 	pl->event = parent_pl->event;
 	pl->operator = parent_pl->operator;
+	pl->op_values = parent_pl->op_values;
 	pl->parent_op = parent_pl->parent_op;
 	switch (newscope) {
 	case SCOPE_BLOCK:
@@ -977,10 +1046,11 @@ static bool parse_ev_amp(ParseLevel *restrict pl) {
 	SAU_Parser *o = pl->o;
 	SAU_Scanner *sc = o->sc;
 	SAU_ParseOpData *op = pl->operator;
-	if (scan_ramp(sc, NULL, &op->amp, false))
+	OpValues *ov = pl->op_values;
+	if (scan_ramp(sc, NULL, &ov->amp, false))
 		op->op_params |= SAU_POPP_AMP;
 	if (SAU_Scanner_tryc(sc, ',')) {
-		if (scan_ramp(sc, NULL, &op->amp2, false))
+		if (scan_ramp(sc, NULL, &ov->amp2, false))
 			op->op_params |= SAU_POPP_AMP2;
 	}
 	if (SAU_Scanner_tryc(sc, '~') && SAU_Scanner_tryc(sc, '[')) {
@@ -1005,13 +1075,14 @@ static bool parse_ev_freq(ParseLevel *restrict pl, bool rel_freq) {
 	SAU_Parser *o = pl->o;
 	SAU_Scanner *sc = o->sc;
 	SAU_ParseOpData *op = pl->operator;
+	OpValues *ov = pl->op_values;
 	if (rel_freq && !(op->op_flags & SAU_PDOP_NESTED))
 		return true; // reject
 	SAU_ScanNumConst_f numconst_f = rel_freq ? NULL : scan_note_const;
-	if (scan_ramp(sc, numconst_f, &op->freq, rel_freq))
+	if (scan_ramp(sc, numconst_f, &ov->freq, rel_freq))
 		op->op_params |= SAU_POPP_FREQ;
 	if (SAU_Scanner_tryc(sc, ',')) {
-		if (scan_ramp(sc, numconst_f, &op->freq2, rel_freq))
+		if (scan_ramp(sc, numconst_f, &ov->freq2, rel_freq))
 			op->op_params |= SAU_POPP_FREQ2;
 	}
 	if (SAU_Scanner_tryc(sc, '~') && SAU_Scanner_tryc(sc, '[')) {
@@ -1024,10 +1095,11 @@ static bool parse_ev_phase(ParseLevel *restrict pl) {
 	SAU_Parser *o = pl->o;
 	SAU_Scanner *sc = o->sc;
 	SAU_ParseOpData *op = pl->operator;
-	if (scan_num(sc, NULL, &op->phase)) {
-		op->phase = fmod(op->phase, 1.f);
-		if (op->phase < 0.f)
-			op->phase += 1.f;
+	OpValues *ov = pl->op_values;
+	if (scan_num(sc, NULL, &ov->phase)) {
+		ov->phase = fmod(ov->phase, 1.f);
+		if (ov->phase < 0.f)
+			ov->phase += 1.f;
 		op->op_params |= SAU_POPP_PHASE;
 	}
 	if (SAU_Scanner_tryc(sc, '+') && SAU_Scanner_tryc(sc, '[')) {
@@ -1075,7 +1147,7 @@ static void parse_in_event(ParseLevel *restrict pl) {
 			if (parse_ev_freq(pl, true)) goto DEFER;
 			break;
 		case 's':
-			scan_time_val(sc, &op->silence_ms);
+			scan_time_val(sc, &pl->op_values->silence_ms);
 			op->op_params |= SAU_POPP_SILENCE;
 			break;
 		case 't':
@@ -1102,7 +1174,7 @@ static void parse_in_event(ParseLevel *restrict pl) {
 			size_t wave;
 			if (!scan_wavetype(sc, &wave))
 				break;
-			op->wave = wave;
+			pl->op_values->wave = wave;
 			op->op_params |= SAU_POPP_WAVE;
 			break; }
 		default:
@@ -1202,7 +1274,7 @@ static void parse_level(SAU_Parser *restrict o,
 			if (!scan_wavetype(sc, &wave))
 				break;
 			begin_node(&pl, NULL, false);
-			pl.operator->wave = wave;
+			pl.op_values->wave = wave;
 			parse_in_event(&pl);
 			break; }
 		case 'S':
@@ -1301,9 +1373,15 @@ SAU_Parse* SAU_create_Parse(const char *restrict script_arg, bool is_path) {
 	const char *name = parse_file(&pr, script_arg, is_path);
 	if (!name) goto DONE;
 
+	uint8_t *msgs;
 	o = SAU_MemPool_alloc(pr.mp, sizeof(SAU_Parse));
+	if (!o || !SAU_ByteArr_mpmemdup(&pr.sc->msgs, &msgs, pr.mp)) {
+		o = NULL;
+		goto DONE;
+	}
 	o->events = pr.first_ev;
 	o->name = name;
+	o->msgs = (const char*) msgs;
 	o->sopt = pr.sl.sopt;
 	o->symtab = pr.st;
 	o->mem = pr.mp;
@@ -1321,5 +1399,5 @@ void SAU_destroy_Parse(SAU_Parse *restrict o) {
 	if (!o)
 		return;
 	SAU_destroy_SymTab(o->symtab);
-	SAU_destroy_MemPool(o->mem);
+	SAU_release_MemPool(o->mem);
 }
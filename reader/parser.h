@@ -49,7 +49,9 @@ enum {
 };
 
 /**
- * Node type for operator data.
+ * Node type for operator data. The values for parameters set in
+ * \a op_params are stored packed, as for program operator data,
+ * once the node is complete; get them using SAU_ParseOpData_VALUE().
  */
 typedef struct SAU_ParseOpData {
 	struct SAU_ParseOpData *range_next;
@@ -59,21 +61,24 @@ typedef struct SAU_ParseOpData {
 	SAU_ParseSublist *last_nest_scope;
 	struct SAU_ParseOpData *next_bound;
 	SAU_SymStr *label;
-	uint32_t op_flags;
+	uint16_t op_flags;
+	uint8_t use_type;
 	/* operator parameters */
 	uint32_t op_params;
 	SAU_Time time;
-	uint32_t silence_ms;
-	uint8_t wave;
-	uint8_t use_type;
-	SAU_Ramp freq, freq2;
-	SAU_Ramp amp, amp2;
-	float phase;
+	uint8_t *values;
 	/* for parseconv */
 	void *op_conv;
 	void *op_context;
 } SAU_ParseOpData;
 
+/**
+ * Get pointer to value for parameter flag \p param in \p od,
+ * valid only if the flag is set.
+ */
+#define SAU_ParseOpData_VALUE(od, param) \
+	SAU_POPV_AT((od)->values, (od)->op_params, (param))
+
 /**
  * Parse data event flags.
  */
@@ -107,6 +112,7 @@ typedef struct SAU_ParseEvData {
 typedef struct SAU_Parse {
 	SAU_ParseEvData *events;
 	const char *name; // currently simply set to the filename
+	const char *msgs; // warnings etc. printed, without path, or NULL
 	SAU_ScriptOptions sopt;
 	SAU_SymTab *symtab;
 	SAU_MemPool *mem; // internally used, provided until destroy
@@ -115,3 +121,5 @@ typedef struct SAU_Parse {
 SAU_Parse *SAU_create_Parse(const char *restrict script_arg, bool is_path)
 	sauMalloclike;
 void SAU_destroy_Parse(SAU_Parse *restrict o);
+
+SAU_Script *SAU_build_Script(SAU_Parse *restrict p) sauMalloclike;
@@ -20,6 +20,10 @@
 
 #define STRBUF_LEN 256
 
+/* Estimates for sizing symbol table from script length. */
+#define SYMTAB_BYTES_PER_SYM 64
+#define SYMTAB_PRESIZE_MAX   (1<<14)
+
 #if SAU_SCANNER_STATS
 static size_t hits = 0;
 static size_t misses = 0;
@@ -64,6 +68,7 @@ void SAU_destroy_Scanner(SAU_Scanner *restrict o) {
 	printf("hits: %zd\nmisses: %zd\n", hits, misses);
 #endif
 	SAU_destroy_File(o->f);
+	SAU_ByteArr_clear(&o->msgs);
 	free(o->strbuf);
 	free(o->filters);
 	free(o);
@@ -87,6 +92,15 @@ bool SAU_Scanner_open(SAU_Scanner *restrict o,
 		return false;
 	}
 
+	/*
+	 * Size symbol table for the script length, when known.
+	 */
+	size_t len = (!is_path) ? strlen(script) : o->f->map_len;
+	size_t syms = len / SYMTAB_BYTES_PER_SYM;
+	if (syms > SYMTAB_PRESIZE_MAX) syms = SYMTAB_PRESIZE_MAX;
+	if (!SAU_SymTab_presize(o->symtab, syms))
+		return false;
+
 	o->sf.line_num = 1; // not increased upon first read
 	o->sf.char_num = 0;
 	o->s_flags |= SAU_SCAN_S_DISCARD;
@@ -264,6 +278,7 @@ uint8_t SAU_Scanner_filter_blockcomment(SAU_Scanner *restrict o,
 	int32_t line_num = o->sf.line_num;
 	int32_t char_num = o->sf.char_num;
 	for (;;) {
+		char_num += SAU_File_skipto(f, check_c);
 		uint8_t c = SAU_File_GETC(f);
 		++char_num;
 		if (c == '\n') {
@@ -776,11 +791,42 @@ bool SAU_Scanner_get_symstr(SAU_Scanner *restrict o,
 	return !truncated;
 }
 
-static void print_stderr(const SAU_Scanner *restrict o,
+/*
+ * Add message to the text kept of those printed, as a line formatted
+ * like that printed but without the file path. The text is kept
+ * NULL-terminated, the terminator included in the count.
+ */
+static void keep_msg(SAU_Scanner *restrict o,
+		const SAU_ScanFrame *restrict sf,
+		const char *restrict prefix, const char *restrict fmt,
+		va_list ap) {
+	char head[64];
+	va_list ap_len;
+	va_copy(ap_len, ap);
+	int len = vsnprintf(NULL, 0, fmt, ap_len);
+	va_end(ap_len);
+	int head_len = snprintf(head, sizeof(head), "%d:%d: %s: ",
+			sf->line_num, sf->char_num, prefix);
+	if (len < 0 || head_len < 0 || (size_t) head_len >= sizeof(head))
+		return;
+	size_t start = (o->msgs.count > 0) ? o->msgs.count - 1 : 0;
+	size_t end = start + head_len + len;
+	if (!SAU_ByteArr_upsize(&o->msgs, end + 2))
+		return;
+	memcpy(&o->msgs.a[start], head, head_len);
+	vsnprintf((char*) &o->msgs.a[start + head_len], len + 1, fmt, ap);
+	o->msgs.a[end] = '\n';
+	o->msgs.a[end + 1] = '\0';
+	o->msgs.count = end + 2;
+}
+
+static void print_stderr(SAU_Scanner *restrict o,
 		const SAU_ScanFrame *restrict sf,
 		const char *restrict prefix, const char *restrict fmt,
 		va_list ap) {
 	SAU_File *f = o->f;
+	va_list ap_keep;
+	va_copy(ap_keep, ap);
 	if (sf != NULL) {
 		fprintf(stderr, "%s:%d:%d: ",
 			f->path, sf->line_num, sf->char_num);
@@ -790,14 +836,19 @@ static void print_stderr(const SAU_Scanner *restrict o,
 	}
 	vfprintf(stderr, fmt, ap);
 	putc('\n', stderr);
+	if (sf != NULL && prefix != NULL)
+		keep_msg(o, sf, prefix, fmt, ap_keep);
+	va_end(ap_keep);
 }
 
 /**
  * Print warning message including file path and position.
  * If \p sf is not NULL, it will be used for position;
  * otherwise, the current position is used.
+ *
+ * The message is also added to \a msgs.
  */
-void SAU_Scanner_warning(const SAU_Scanner *restrict o,
+void SAU_Scanner_warning(SAU_Scanner *restrict o,
 		const SAU_ScanFrame *restrict sf,
 		const char *restrict fmt, ...) {
 	if (o->s_flags & SAU_SCAN_S_QUIET)
@@ -814,6 +865,7 @@ void SAU_Scanner_warning(const SAU_Scanner *restrict o,
  * If \p sf is not NULL, it will be used for position;
  * otherwise, the current position is used.
  *
+ * The message is also added to \a msgs.
  * Sets the scanner state error flag.
  */
 void SAU_Scanner_error(SAU_Scanner *restrict o,
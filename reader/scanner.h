@@ -14,6 +14,7 @@
 #pragma once
 #include "file.h"
 #include "symtab.h"
+#include "../arrtype.h"
 
 struct SAU_Scanner;
 typedef struct SAU_Scanner SAU_Scanner;
@@ -144,6 +145,7 @@ struct SAU_Scanner {
 	uint8_t ws_level; // level of SAU_Scanner_setws_level(), presuming use
 	uint8_t *strbuf;
 	void *data; // for use by user
+	SAU_ByteArr msgs; // text of messages printed, without file path
 	SAU_ScanFrame undo[SAU_SCAN_UNGET_MAX + 1];
 };
 
@@ -205,7 +207,7 @@ bool SAU_Scanner_getd(SAU_Scanner *restrict o,
 bool SAU_Scanner_get_symstr(SAU_Scanner *restrict o,
 		SAU_SymStr **restrict symstrp);
 
-void SAU_Scanner_warning(const SAU_Scanner *restrict o,
+void SAU_Scanner_warning(SAU_Scanner *restrict o,
 		const SAU_ScanFrame *restrict sf,
 		const char *restrict fmt, ...) sauPrintflike(3, 4);
 void SAU_Scanner_error(SAU_Scanner *restrict o,
@@ -15,92 +15,109 @@
 #include <string.h>
 #include <stdlib.h>
 
-#define STRTAB_ALLOC_INITIAL 1024
+#define STRTAB_ALLOC_INITIAL 256
 
-#ifndef SAU_SYMTAB_STATS
 /*
- * Print symbol table statistics for testing?
+ * Hash table slot, with the full hash kept beside the item so that
+ * probing mostly compares slots without following item pointers.
+ * Empty if item is NULL.
  */
-# define SAU_SYMTAB_STATS 0
-#endif
-#if SAU_SYMTAB_STATS
-static size_t collision_count = 0;
-#include <stdio.h>
-#endif
+typedef struct StrSlot {
+	uint64_t hash;
+	SAU_SymStr *item;
+} StrSlot;
 
+/*
+ * Open addressing hash table with linear probing,
+ * kept at most half full. Items are allocated in
+ * the memory pool and never move.
+ */
 typedef struct StrTab {
-	SAU_SymStr **items;
+	StrSlot *slots;
 	size_t count;
 	size_t alloc;
+	size_t lookups;
+	size_t probes;
+	size_t upsizes;
 } StrTab;
 
 static inline void fini_StrTab(StrTab *restrict o) {
-	free(o->items);
+	free(o->slots);
+}
+
+#define HASH_MUL1 UINT64_C(0x9E3779B97F4A7C15)
+#define HASH_MUL2 UINT64_C(0xC2B2AE3D27D4EB4F)
+#define HASH_ROTL(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+
+static inline uint64_t hash_mix(uint64_t h, uint64_t v) {
+	h ^= v * HASH_MUL1;
+	return HASH_ROTL(h, 31) * HASH_MUL2;
 }
 
 /*
- * Return the hash of the given string \p key of lenght \p len.
+ * Return the hash of the given string \p key of length \p len.
+ *
+ * Reads 8 bytes at a time, mixing each word in by multiplication
+ * and rotation, with the remaining bytes read as a final word.
  *
  * \return hash
  */
-static size_t StrTab_hash_key(StrTab *restrict o,
-		const char *restrict key, size_t len) {
-	size_t i;
-	size_t hash;
+static uint64_t hash_key(const void *restrict key, size_t len) {
+	const uint8_t *s = key;
+	uint64_t h = len * HASH_MUL2;
+	uint64_t v;
+	for (; len >= 8; s += 8, len -= 8) {
+		memcpy(&v, s, 8);
+		h = hash_mix(h, v);
+	}
+	if (len > 0) {
+		v = 0;
+		memcpy(&v, s, len);
+		h = hash_mix(h, v);
+	}
 	/*
-	 * Calculate DJB2 hash,
-	 * varied by adding len.
+	 * Finalize, so that the low bits used
+	 * for the table index are well-mixed.
 	 */
-	hash = 5381 + (len * 33);
-	for (i = 0; i < len; ++i) {
-		size_t c = key[i];
-		hash = ((hash << 5) + hash) ^ c;
-	}
-	hash &= (o->alloc - 1);
-	return hash;
+	h ^= h >> 33;
+	h *= UINT64_C(0xFF51AFD7ED558CCD);
+	h ^= h >> 33;
+	h *= UINT64_C(0xC4CEB9FE1A85EC53);
+	h ^= h >> 33;
+	return h;
 }
 
 /*
- * Increase the size of the hash table.
+ * Resize the hash table to \p alloc slots,
+ * a power of two larger than twice the count.
  *
  * \return true, or false on allocation failure
  */
-static bool StrTab_upsize(StrTab *restrict o) {
-	SAU_SymStr **items, **old_items = o->items;
-	size_t alloc, old_alloc = o->alloc;
-	size_t i;
-	alloc = (old_alloc > 0) ?
-		(old_alloc << 1) :
-		STRTAB_ALLOC_INITIAL;
-	items = calloc(alloc, sizeof(SAU_SymStr*));
-	if (!items)
+static bool StrTab_resize(StrTab *restrict o, size_t alloc) {
+	StrSlot *slots, *old_slots = o->slots;
+	size_t old_alloc = o->alloc;
+	slots = calloc(alloc, sizeof(StrSlot));
+	if (!slots)
 		return false;
 	o->alloc = alloc;
-	o->items = items;
+	o->slots = slots;
+	if (old_slots != NULL)
+		++o->upsizes;
 
 	/*
-	 * Rehash entries
+	 * Reinsert entries, using the stored hashes.
 	 */
-	for (i = 0; i < old_alloc; ++i) {
-		SAU_SymStr *item = old_items[i];
-		while (item != NULL) {
-			SAU_SymStr *prev_item;
-			size_t hash;
-			hash = StrTab_hash_key(o, item->key, item->key_len);
-			/*
-			 * Before adding the entry to the new table, set
-			 * item->prev to the previous (if any) item with
-			 * the same hash in the new table. Done repeatedly,
-			 * the links are rebuilt, though not necessarily in
-			 * the same order.
-			 */
-			prev_item = item->prev;
-			item->prev = o->items[hash];
-			o->items[hash] = item;
-			item = prev_item;
-		}
+	size_t mask = alloc - 1;
+	for (size_t i = 0; i < old_alloc; ++i) {
+		StrSlot *old = &old_slots[i];
+		if (!old->item)
+			continue;
+		size_t j = old->hash & mask;
+		while (slots[j].item != NULL)
+			j = (j + 1) & mask;
+		slots[j] = *old;
 	}
-	free(old_items);
+	free(old_slots);
 	return true;
 }
 
@@ -118,28 +135,39 @@ static SAU_SymStr *StrTab_unique_item(StrTab *restrict o,
 		const void *restrict key, size_t len, size_t extra) {
 	if (!key || len == 0)
 		return NULL;
-	if (o->count == (o->alloc / 2)) {
-		if (!StrTab_upsize(o))
-			return NULL;
-	}
-
-	size_t hash = StrTab_hash_key(o, key, len);
-	SAU_SymStr *item = o->items[hash];
-	while (item != NULL) {
-		if (item->key_len == len &&
-			!memcmp(item->key, key, len)) return item;
-		item = item->prev;
-#if SAU_SYMTAB_STATS
-		++collision_count;
-#endif
+	if (!o->alloc && !StrTab_resize(o, STRTAB_ALLOC_INITIAL))
+		return NULL;
+	++o->lookups;
+	uint64_t hash = hash_key(key, len);
+	size_t mask = o->alloc - 1;
+	size_t i = hash & mask;
+	StrSlot *slot;
+	for (;;) {
+		slot = &o->slots[i];
+		if (!slot->item)
+			break;
+		if (slot->hash == hash && slot->item->key_len == len &&
+			!memcmp(slot->item->key, key, len)) return slot->item;
+		++o->probes;
+		i = (i + 1) & mask;
 	}
-	item = SAU_MemPool_alloc(memp, sizeof(SAU_SymStr) + (len + extra));
+	SAU_SymStr *item = SAU_MemPool_alloc(memp,
+			sizeof(SAU_SymStr) + (len + extra));
 	if (!item)
 		return NULL;
-	item->prev = o->items[hash];
-	o->items[hash] = item;
 	item->key_len = len;
 	memcpy(item->key, key, len);
+	if (o->count + 1 > (o->alloc / 2)) {
+		if (!StrTab_resize(o, o->alloc << 1))
+			return NULL;
+		mask = o->alloc - 1;
+		i = hash & mask;
+		while (o->slots[i].item != NULL)
+			i = (i + 1) & mask;
+		slot = &o->slots[i];
+	}
+	slot->hash = hash;
+	slot->item = item;
 	++o->count;
 	return item;
 }
@@ -170,10 +198,38 @@ SAU_SymTab *SAU_create_SymTab(SAU_MemPool *restrict mempool) {
 void SAU_destroy_SymTab(SAU_SymTab *restrict o) {
 	if (!o)
 		return;
-#if SAU_SYMTAB_STATS
-	printf("collision count: %zd\n", collision_count);
-#endif
 	fini_StrTab(&o->strtab);
+	free(o);
+}
+
+/**
+ * Make room in the hash table for at least \p count unique strings
+ * without further growing, e.g. for an estimate based on input size.
+ * Never shrinks the table.
+ *
+ * \return true, or false on allocation failure
+ */
+bool SAU_SymTab_presize(SAU_SymTab *restrict o, size_t count) {
+	StrTab *st = &o->strtab;
+	size_t alloc = (st->alloc > 0) ? st->alloc : STRTAB_ALLOC_INITIAL;
+	while (alloc / 2 < count)
+		alloc <<= 1;
+	if (alloc == st->alloc)
+		return true;
+	return StrTab_resize(st, alloc);
+}
+
+/**
+ * Get statistics for the symbol table, counted since creation.
+ */
+void SAU_SymTab_get_stats(const SAU_SymTab *restrict o,
+		SAU_SymTabStats *restrict stats) {
+	const StrTab *st = &o->strtab;
+	stats->count = st->count;
+	stats->alloc = st->alloc;
+	stats->lookups = st->lookups;
+	stats->probes = st->probes;
+	stats->upsizes = st->upsizes;
 }
 
 /**
@@ -18,7 +18,6 @@
  * Item stored for each unique string associated with the symbol table.
  */
 typedef struct SAU_SymStr {
-	struct SAU_SymStr *prev;
 	void *data;
 	size_t key_len;
 	char key[];
@@ -27,9 +26,24 @@ typedef struct SAU_SymStr {
 struct SAU_SymTab;
 typedef struct SAU_SymTab SAU_SymTab;
 
+/**
+ * Statistics for a symbol table, counted as it's used.
+ */
+typedef struct SAU_SymTabStats {
+	size_t count;   // unique strings held
+	size_t alloc;   // slots in hash table
+	size_t lookups; // calls getting a string
+	size_t probes;  // slots passed over for other strings
+	size_t upsizes; // times hash table grown
+} SAU_SymTabStats;
+
 SAU_SymTab *SAU_create_SymTab(SAU_MemPool *restrict mempool) sauMalloclike;
 void SAU_destroy_SymTab(SAU_SymTab *restrict o);
 
+bool SAU_SymTab_presize(SAU_SymTab *restrict o, size_t count);
+void SAU_SymTab_get_stats(const SAU_SymTab *restrict o,
+		SAU_SymTabStats *restrict stats);
+
 SAU_SymStr *SAU_SymTab_get_symstr(SAU_SymTab *restrict o,
 		const void *restrict str, size_t len);
 
@@ -13,6 +13,7 @@
 
 #include "saugns.h"
 #include "help.h"
+#include "trace.h"
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
@@ -42,8 +43,12 @@ static void print_help(const char *restrict topic,
 static void print_usage(bool h_arg, const char *restrict h_type) {
 	fputs(
 "Usage: "NAME" [-a|-m] [-r <srate>] [-o <wavfile>] [options] <script>...\n"
-"       "NAME" [-c] [options] <script>...\n"
-"Common options: [-e] [-p]\n",
+"       "NAME" [-c] [-r <srate>] [options] <script>...\n"
+"       "NAME" [-r <srate>] --serve <socket> [--jobs <n>]\n"
+"Common options: [-e] [-p] [--cost] [--cache <dir>] [--mem-stats]\n"
+"                [--profile] [--trace <file>]\n"
+"WAV file options: [--checkpoint <secs>] [--resume]\n"
+"Audio device options: [--budget <percent>] [--stats]\n",
 		stderr);
 	if (!h_type)
 		fputs(
@@ -53,12 +58,46 @@ static void print_usage(bool h_arg, const char *restrict h_type) {
 "  -a \tAudible; always enable audio device output.\n"
 "  -m \tMuted; always disable audio device output.\n"
 "  -r \tSample rate in Hz (default "SAU_STREXP(SAU_DEFAULT_SRATE)");\n"
-"     \tif unsupported for audio device, warns and prints rate used instead.\n"
+"     \tif unsupported for audio device, warns and prints rate used instead;\n"
+"     \twith -c, used for --cost.\n"
 "  -o \tWrite a 16-bit PCM WAV file, always using the sample rate requested;\n"
 "     \tdisables audio device output by default.\n"
 "  -e \tEvaluate strings instead of files.\n"
 "  -c \tCheck scripts only, reporting any errors or requested info.\n"
 "  -p \tPrint info for scripts after loading.\n"
+"  --cost\n"
+"     \tPrint render cost estimate for scripts after loading, including\n"
+"     \tCPU time from kernel timing, kept in the --cache directory if given.\n"
+"  --cache\n"
+"     \tKeep built programs in the directory given, reusing them for\n"
+"     \tscripts with the same contents instead of parsing them again.\n"
+"  --mem-stats\n"
+"     \tPrint memory use for each stage of building and running scripts.\n"
+"  --profile\n"
+"     \tTime rendering per kernel type, operator, and voice, and print\n"
+"     \tthe operators and voices taking the most time for scripts run.\n"
+"  --trace\n"
+"     \tWrite timed spans for building, running, and output of scripts\n"
+"     \tto the file given, as trace event JSON for trace viewers.\n"
+"  --checkpoint\n"
+"     \tWrite checkpoint '<wavfile>.ckpt' at interval in seconds of audio,\n"
+"     \tfor WAV file output without audio device; removed when done.\n"
+"  --resume\n"
+"     \tResume interrupted WAV file output from its checkpoint,\n"
+"     \tgiven the same scripts and options.\n"
+"  --budget\n"
+"     \tDrop the quietest voices as needed to generate audio device output\n"
+"     \twithin the percentage of real time given, warning when doing so.\n"
+"  --stats\n"
+"     \tPrint headroom left generating audio device output in real time,\n"
+"     \tand underruns, every "SAU_STREXP(SAU_STATS_SECS)" seconds"
+	" and for each script played.\n"
+"  --serve\n"
+"     \tRender scripts sent to the UNIX domain socket given, until\n"
+"     \tinterrupted; -r sets the default sample rate. See saugns(1).\n"
+"  --jobs\n"
+"     \tNumber of requests to --serve at a time (default "
+	SAU_STREXP(SAU_DEFAULT_JOBS)").\n"
 "  -h \tPrint this and list help topics, or print help for '-h <topic>'.\n"
 "  -v \tPrint version.\n",
 			stderr);
@@ -92,6 +131,38 @@ static int32_t get_piarg(const char *restrict str) {
 	return i;
 }
 
+/*
+ * Values for long options without short option equivalents.
+ */
+enum {
+	OPT_BUDGET = 256,
+	OPT_CACHE,
+	OPT_CHECKPOINT,
+	OPT_COST,
+	OPT_JOBS,
+	OPT_MEM_STATS,
+	OPT_PROFILE,
+	OPT_RESUME,
+	OPT_SERVE,
+	OPT_STATS,
+	OPT_TRACE,
+};
+
+static const struct SAU_longopt longopts[] = {
+	{"budget", OPT_BUDGET, true},
+	{"cache", OPT_CACHE, true},
+	{"checkpoint", OPT_CHECKPOINT, true},
+	{"cost", OPT_COST, false},
+	{"jobs", OPT_JOBS, true},
+	{"mem-stats", OPT_MEM_STATS, false},
+	{"profile", OPT_PROFILE, false},
+	{"resume", OPT_RESUME, false},
+	{"serve", OPT_SERVE, true},
+	{"stats", OPT_STATS, false},
+	{"trace", OPT_TRACE, true},
+	{NULL, 0, false}
+};
+
 /*
  * Parse command line arguments.
  *
@@ -103,7 +174,13 @@ static bool parse_args(int argc, char **restrict argv,
 		uint32_t *restrict flags,
 		SAU_PtrArr *restrict script_args,
 		const char **restrict wav_path,
-		uint32_t *restrict srate) {
+		uint32_t *restrict srate,
+		uint32_t *restrict ckpt_secs,
+		const char **restrict cache_dir,
+		const char **restrict serve_path,
+		uint32_t *restrict jobs,
+		uint32_t *restrict budget_pct,
+		const char **restrict trace_path) {
 	struct SAU_opt opt = (struct SAU_opt){0};
 	int c;
 	int32_t i;
@@ -112,6 +189,7 @@ static bool parse_args(int argc, char **restrict argv,
 	const char *h_type = NULL;
 	*srate = SAU_DEFAULT_SRATE;
 	opt.err = 1;
+	opt.longopts = longopts;
 REPARSE:
 	while ((c = SAU_getopt(argc, argv, "amr:o:ecphv", &opt)) != -1) {
 		switch (c) {
@@ -151,9 +229,6 @@ REPARSE:
 			*flags |= SAU_ARG_PRINT_INFO;
 			break;
 		case 'r':
-			if ((*flags & SAU_ARG_MODE_CHECK) != 0)
-				goto USAGE;
-			*flags |= SAU_ARG_MODE_FULL;
 			i = get_piarg(opt.arg);
 			if (i < 0) goto USAGE;
 			*srate = i;
@@ -161,6 +236,53 @@ REPARSE:
 		case 'v':
 			print_version();
 			goto ABORT;
+		case OPT_BUDGET:
+			if ((*flags & SAU_ARG_MODE_CHECK) != 0)
+				goto USAGE;
+			i = get_piarg(opt.arg);
+			if (i < 0 || i > 100) goto USAGE;
+			*budget_pct = i;
+			continue;
+		case OPT_CACHE:
+			*cache_dir = opt.arg;
+			continue;
+		case OPT_CHECKPOINT:
+			if ((*flags & SAU_ARG_MODE_CHECK) != 0)
+				goto USAGE;
+			i = get_piarg(opt.arg);
+			if (i < 0) goto USAGE;
+			*ckpt_secs = i;
+			continue;
+		case OPT_COST:
+			*flags |= SAU_ARG_PRINT_COST;
+			break;
+		case OPT_JOBS:
+			i = get_piarg(opt.arg);
+			if (i < 0) goto USAGE;
+			*jobs = i;
+			continue;
+		case OPT_MEM_STATS:
+			*flags |= SAU_ARG_MEM_STATS;
+			break;
+		case OPT_PROFILE:
+			*flags |= SAU_ARG_PROFILE;
+			break;
+		case OPT_SERVE:
+			*serve_path = opt.arg;
+			continue;
+		case OPT_STATS:
+			if ((*flags & SAU_ARG_MODE_CHECK) != 0)
+				goto USAGE;
+			*flags |= SAU_ARG_PLAY_STATS;
+			break;
+		case OPT_TRACE:
+			*trace_path = opt.arg;
+			continue;
+		case OPT_RESUME:
+			if ((*flags & SAU_ARG_MODE_CHECK) != 0)
+				goto USAGE;
+			*flags |= SAU_ARG_RESUME;
+			break;
 		default:
 			fputs("Pass -h for general usage help.\n", stderr);
 			goto ABORT;
@@ -169,7 +291,7 @@ REPARSE:
 	if (opt.ind > 1 && !strcmp(argv[opt.ind - 1], "--")) dashdash = true;
 	for (;;) {
 		if (opt.ind >= argc || !argv[opt.ind]) {
-			if (!script_args->count) goto USAGE;
+			if (!script_args->count && !*serve_path) goto USAGE;
 			break;
 		}
 		const char *arg = argv[opt.ind];
@@ -178,6 +300,8 @@ REPARSE:
 		++opt.ind;
 		c = 0; /* only goto REPARSE after advancing, to prevent hang */
 	}
+	if ((*ckpt_secs > 0 || (*flags & SAU_ARG_RESUME) != 0) && !*wav_path)
+		goto USAGE;
 	return true;
 USAGE:
 	print_usage(h_arg, h_type);
@@ -195,18 +319,33 @@ int main(int argc, char **restrict argv) {
 	const char *wav_path = NULL;
 	uint32_t options = 0;
 	uint32_t srate = 0;
+	uint32_t ckpt_secs = 0;
+	const char *cache_dir = NULL;
+	const char *serve_path = NULL;
+	uint32_t jobs = SAU_DEFAULT_JOBS;
+	uint32_t budget_pct = 0;
+	const char *trace_path = NULL;
 	if (!parse_args(argc, argv, &options, &script_args, &wav_path,
-			&srate))
+			&srate, &ckpt_secs, &cache_dir, &serve_path, &jobs,
+			&budget_pct, &trace_path))
 		return 0;
-	bool error = !SAU_build(&script_args, options, &prg_objs);
-	SAU_PtrArr_clear(&script_args);
-	if (error)
+	if (serve_path != NULL) {
+		SAU_PtrArr_clear(&script_args);
+		return SAU_serve(serve_path, srate, jobs) ? 0 : 1;
+	}
+	if (trace_path != NULL && !SAU_open_Trace(trace_path)) {
+		SAU_PtrArr_clear(&script_args);
 		return 1;
-	if (prg_objs.count > 0) {
-		error = !SAU_play(&prg_objs, srate, options, wav_path);
+	}
+	bool error = !SAU_build(&script_args, options, &prg_objs, cache_dir);
+	SAU_PtrArr_clear(&script_args);
+	if (!error && prg_objs.count > 0) {
+		error = !SAU_play(&prg_objs, srate, options, wav_path,
+				ckpt_secs, cache_dir, budget_pct);
 		SAU_discard(&prg_objs);
-		if (error)
-			return 1;
 	}
-	return 0;
+	if (!SAU_close_Trace())
+		error = true;
+	SAU_clear_MemPool_cache();
+	return error ? 1 : 0;
 }
@@ -13,12 +13,15 @@
 
 #pragma once
 #include "program.h"
+#include "mempool.h"
 #include "ptrarr.h"
 
 #define SAU_CLINAME_STR "saugns"
 #define SAU_VERSION_STR "v0.3-dev"
 
 #define SAU_DEFAULT_SRATE 96000
+#define SAU_DEFAULT_JOBS 4
+#define SAU_STATS_SECS 10
 
 /**
  * Command line options flags.
@@ -30,11 +33,24 @@ enum {
 	SAU_ARG_MODE_CHECK    = 1<<3,
 	SAU_ARG_PRINT_INFO    = 1<<4,
 	SAU_ARG_EVAL_STRING   = 1<<5,
+	SAU_ARG_RESUME        = 1<<6,
+	SAU_ARG_MEM_STATS     = 1<<7,
+	SAU_ARG_PRINT_COST    = 1<<8,
+	SAU_ARG_PROFILE       = 1<<9,
+	SAU_ARG_PLAY_STATS    = 1<<10,
 };
 
 size_t SAU_build(const SAU_PtrArr *restrict script_args, uint32_t options,
-		SAU_PtrArr *restrict prg_objs);
+		SAU_PtrArr *restrict prg_objs, const char *restrict cache_dir);
 void SAU_discard(SAU_PtrArr *restrict prg_objs);
 
+void SAU_print_mem_stats(const char *restrict label,
+		const SAU_MemPoolStats *restrict stats);
+
 bool SAU_play(const SAU_PtrArr *restrict prg_objs, uint32_t srate,
-		uint32_t options, const char *restrict wav_path);
+		uint32_t options, const char *restrict wav_path,
+		uint32_t ckpt_secs, const char *restrict cache_dir,
+		uint32_t budget_pct);
+
+bool SAU_serve(const char *restrict sock_path, uint32_t srate,
+		uint32_t jobs);
@@ -14,6 +14,7 @@
 #pragma once
 #include "reflist.h"
 #include "program.h"
+#include "mempool.h"
 
 /**
  * Points to bounding members of a linearly ordered list of nodes.
@@ -30,27 +31,32 @@ enum {
 };
 
 /**
- * Node type for operator data.
+ * Node type for operator data. Only the values for parameters set in
+ * \a op_params are stored, packed after the struct as for program
+ * operator data; get them using SAU_ScriptOpData_VALUE().
  */
 typedef struct SAU_ScriptOpData {
 	struct SAU_ScriptOpData *range_next;
 	struct SAU_ScriptEvData *event;
 	struct SAU_ScriptOpData *next_bound;
 	struct SAU_ScriptOpData *prev_use, *next_use; /* for same op(s) */
+	/* new node adjacents in operator linkage graph */
+	SAU_RefList *mod_lists;
 	uint32_t op_flags;
 	/* operator parameters */
 	uint32_t op_id; // for scriptconv
 	uint32_t op_params;
 	SAU_Time time;
-	uint32_t silence_ms;
-	uint8_t wave;
-	SAU_Ramp freq, freq2;
-	SAU_Ramp amp, amp2;
-	float phase;
-	/* new node adjacents in operator linkage graph */
-	SAU_RefList *mod_lists;
+	uint8_t values[];
 } SAU_ScriptOpData;
 
+/**
+ * Get pointer to value for parameter flag \p param in \p od,
+ * valid only if the flag is set.
+ */
+#define SAU_ScriptOpData_VALUE(od, param) \
+	SAU_POPV_AT((od)->values, (od)->op_params, (param))
+
 /**
  * Script data event flags.
  */
@@ -113,8 +119,10 @@ struct SAU_MemPool;
 typedef struct SAU_Script {
 	SAU_ScriptEvData *events;
 	const char *name; // currently simply set to the filename
+	const char *msgs; // warnings etc. printed, without path, or NULL
 	SAU_ScriptOptions sopt;
 	struct SAU_MemPool *mem; // internally used, provided until destroy
+	SAU_MemPoolStats parse_mem; // for parser data, freed after loading
 } SAU_Script;
 
 SAU_Script *SAU_load_Script(const char *restrict script_arg, bool is_path)
@@ -0,0 +1,364 @@
+/* saugns: Benchmark program for script building stages.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "saugns.h"
+#include "arrtype.h"
+#include "reader/parser.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define NAME "test-build"
+
+/*
+ * Kinds of stress script generated.
+ */
+enum {
+	GEN_NOTES = 0,
+	GEN_NEST,
+	GEN_LABELS,
+	GEN_COMPOSITE,
+	GEN_COMMENTS,
+	GEN_KINDS,
+	GEN_ALL = GEN_KINDS,
+};
+
+static const char *const gen_names[GEN_KINDS + 1] = {
+	"notes",
+	"nest",
+	"labels",
+	"composite",
+	"comments",
+	"all",
+};
+
+typedef struct GenOpt {
+	uint32_t kind;
+	uint32_t notes;
+	uint32_t depth;
+	uint32_t repeats;
+	const char *out_path;
+} GenOpt;
+
+#define DEFAULT_NOTES   10000
+#define DEFAULT_DEPTH   4
+#define DEFAULT_REPEATS 5
+#define COMPOSITE_PARTS 8
+
+/*
+ * Print command line usage instructions.
+ */
+static void print_usage(void) {
+	fputs(
+"Usage: "NAME" [-k <kind>] [-n <notes>] [-d <depth>] [-r <repeats>]\n"
+"       "NAME" [-k <kind>] [-n <notes>] [-d <depth>] -o <file>\n"
+"\n"
+"Generate a stress script and time building it, for each stage:\n"
+"parsing, conversion to script data, and building the program.\n"
+"\n"
+"  -k \tKind of script: notes (default), nest, labels, composite,\n"
+"     \tcomments, or all to time each in turn.\n"
+"  -n \tNumber of notes (default "SAU_STREXP(DEFAULT_NOTES)").\n"
+"  -d \tModulator nesting depth for nest (default "
+	SAU_STREXP(DEFAULT_DEPTH)").\n"
+"  -r \tTimes to repeat each stage, keeping the fastest (default "
+	SAU_STREXP(DEFAULT_REPEATS)").\n"
+"  -o \tWrite the generated script to file instead of timing.\n"
+"  -h \tPrint this message.\n"
+"  -v \tPrint version.\n",
+		stderr);
+}
+
+/*
+ * Print version.
+ */
+static void print_version(void) {
+	puts(NAME" ("SAU_CLINAME_STR") "SAU_VERSION_STR);
+}
+
+/*
+ * Read a positive integer from the given string.
+ *
+ * \return positive value or -1 if invalid
+ */
+static int32_t get_piarg(const char *restrict str) {
+	char *endp;
+	int32_t i;
+	errno = 0;
+	i = strtol(str, &endp, 10);
+	if (errno || i <= 0 || endp == str || *endp)
+		return -1;
+	return i;
+}
+
+/*
+ * Parse command line arguments.
+ *
+ * Print usage instructions if requested or args invalid.
+ *
+ * \return true if args valid
+ */
+static bool parse_args(int argc, char **restrict argv,
+		GenOpt *restrict go) {
+	struct SAU_opt opt = (struct SAU_opt){0};
+	int c;
+	int32_t i;
+	*go = (GenOpt){GEN_NOTES, DEFAULT_NOTES, DEFAULT_DEPTH,
+		DEFAULT_REPEATS, NULL};
+	opt.err = 1;
+	while ((c = SAU_getopt(argc, argv, "k:n:d:r:o:hv", &opt)) != -1) {
+		switch (c) {
+		case 'd':
+			if ((i = get_piarg(opt.arg)) < 0) goto USAGE;
+			go->depth = i;
+			break;
+		case 'h':
+			goto USAGE;
+		case 'k':
+			for (i = 0; i <= GEN_KINDS; ++i)
+				if (!strcmp(opt.arg, gen_names[i])) break;
+			if (i > GEN_KINDS) goto USAGE;
+			go->kind = i;
+			break;
+		case 'n':
+			if ((i = get_piarg(opt.arg)) < 0) goto USAGE;
+			go->notes = i;
+			break;
+		case 'o':
+			go->out_path = opt.arg;
+			break;
+		case 'r':
+			if ((i = get_piarg(opt.arg)) < 0) goto USAGE;
+			go->repeats = i;
+			break;
+		case 'v':
+			print_version();
+			return false;
+		default:
+			fputs("Pass -h for usage help.\n", stderr);
+			return false;
+		}
+	}
+	if (opt.ind < argc) goto USAGE;
+	if (go->out_path != NULL && go->kind == GEN_ALL) goto USAGE;
+	return true;
+USAGE:
+	print_usage();
+	return false;
+}
+
+/*
+ * Append formatted text to \p text.
+ *
+ * \return true, or false on allocation failure
+ */
+static sauPrintflike(2, 3) bool put(SAU_ByteArr *restrict text,
+		const char *restrict fmt, ...) {
+	va_list ap;
+	for (;;) {
+		size_t room = text->asize - text->count;
+		va_start(ap, fmt);
+		int len = vsnprintf((char*) &text->a[text->count], room,
+				fmt, ap);
+		va_end(ap);
+		if (len < 0)
+			return false;
+		if ((size_t) len < room) {
+			text->count += len;
+			return true;
+		}
+		if (!SAU_ByteArr_upsize(text, text->count + len + 4096))
+			return false;
+	}
+}
+
+/*
+ * Generate script of the given kind into \p text,
+ * zero-terminated.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool generate(SAU_ByteArr *restrict text, uint32_t kind,
+		const GenOpt *restrict go) {
+	text->count = 0;
+	if (!SAU_ByteArr_upsize(text, 4096))
+		return false;
+	if (!put(text, "/* %s: %u notes */\nS a.1\n",
+				gen_names[kind], go->notes))
+		return false;
+	for (uint32_t i = 0; i < go->notes; ++i) {
+		uint32_t freq = 100 + (i * 37) % 1900;
+		bool ok = true;
+		switch (kind) {
+		case GEN_NOTES:
+			ok = put(text, "\\0.01 Osin f%u.%02u a0.%u t0.05\n",
+					freq, i % 100, 1 + i % 9);
+			break;
+		case GEN_NEST:
+			ok = put(text, "\\0.01 Osin f%u t0.05", freq);
+			for (uint32_t d = 0; ok && d < go->depth; ++d)
+				ok = put(text, " p+[Osin r%u.5 a0.5", 1 + d);
+			for (uint32_t d = 0; ok && d < go->depth; ++d)
+				ok = put(text, "]");
+			if (ok) ok = put(text, "\n");
+			break;
+		case GEN_LABELS:
+			/*
+			 * Each new label is followed by updates for some
+			 * labels defined earlier.
+			 */
+			ok = put(text, "\\0.01 'n%u Osin f%u t0.5\n", i, freq);
+			if (ok && i >= 4)
+				ok = put(text, "@n%u f%u a0.5\n@n%u a0.25\n",
+						i - 4, freq, i - 3);
+			break;
+		case GEN_COMPOSITE:
+			ok = put(text, "\\0.01 Osin f%u t0.01", freq);
+			for (uint32_t p = 1; ok && p < COMPOSITE_PARTS; ++p)
+				ok = put(text, " ; f%u", freq + p * 10);
+			if (ok) ok = put(text, "\n");
+			break;
+		case GEN_COMMENTS:
+			ok = put(text,
+"// note %u, with a line comment longer than the note itself\n"
+"/* and a block comment,\n * spanning lines, for note %u */\n"
+"#! and a shebang comment\n"
+"\\0.01 Osin f%u t0.05 /* trailing */\n",
+					i, i, freq);
+			break;
+		}
+		if (!ok)
+			return false;
+	}
+	text->a[text->count] = '\0';
+	return true;
+}
+
+/*
+ * Stages timed.
+ */
+enum {
+	STAGE_PARSE = 0,
+	STAGE_SCRIPT,
+	STAGE_PROGRAM,
+	STAGE_TOTAL,
+	STAGES
+};
+
+static const char *const stage_names[STAGES] = {
+	"Parse:  ",
+	"Script: ",
+	"Program:",
+	"Total:  ",
+};
+
+/*
+ * Time each building stage for \p text, keeping the fastest run
+ * of each, and print results.
+ *
+ * \return true unless building failed
+ */
+static bool time_build(const SAU_ByteArr *restrict text,
+		const char *restrict kind_name, uint32_t repeats) {
+	double best[STAGES];
+	size_t ev_count = 0;
+	for (int i = 0; i < STAGES; ++i) best[i] = -1.0;
+	for (uint32_t r = 0; r < repeats; ++r) {
+		double t[STAGES];
+		uint64_t t0 = SAU_time_ns();
+		SAU_Parse *p = SAU_create_Parse((const char*) text->a, false);
+		uint64_t t1 = SAU_time_ns();
+		SAU_Script *sd = (p != NULL) ? SAU_build_Script(p) : NULL;
+		uint64_t t2 = SAU_time_ns();
+		SAU_destroy_Parse(p);
+		uint64_t t3 = SAU_time_ns();
+		SAU_Program *prg = (sd != NULL) ? SAU_build_Program(sd) : NULL;
+		uint64_t t4 = SAU_time_ns();
+		if (prg != NULL) ev_count = prg->ev_count;
+		SAU_discard_Program(prg);
+		SAU_discard_Script(sd);
+		if (!prg) {
+			SAU_error(NAME, "building %s script failed",
+					kind_name);
+			return false;
+		}
+		t[STAGE_PARSE] = (t1 - t0) * 1e-6;
+		t[STAGE_SCRIPT] = (t2 - t1) * 1e-6;
+		t[STAGE_PROGRAM] = (t4 - t3) * 1e-6;
+		t[STAGE_TOTAL] = t[STAGE_PARSE] + t[STAGE_SCRIPT] +
+			t[STAGE_PROGRAM];
+		for (int i = 0; i < STAGES; ++i)
+			if (best[i] < 0.0 || t[i] < best[i]) best[i] = t[i];
+	}
+	double mb = text->count / (1024.0 * 1024.0);
+	fprintf(stdout, "Script: %s, %zd bytes, %zd events\n",
+			kind_name, text->count, ev_count);
+	for (int i = 0; i < STAGES; ++i) {
+		double secs = best[i] / 1000.0;
+		if (secs <= 0.0) secs = 1e-9;
+		fprintf(stdout,
+			"\t%s\t%9.3f ms\t%8.2f MB/s\t%10.0f events/s\n",
+			stage_names[i], best[i], mb / secs, ev_count / secs);
+	}
+	return true;
+}
+
+/*
+ * Write generated script to file at \p path.
+ *
+ * \return true unless writing failed
+ */
+static bool write_script(const SAU_ByteArr *restrict text,
+		const char *restrict path) {
+	FILE *f = fopen(path, "wb");
+	bool ok = (f != NULL) &&
+		(fwrite(text->a, 1, text->count, f) == text->count);
+	if (f != NULL && fclose(f) != 0) ok = false;
+	if (!ok)
+		SAU_error(NAME, "couldn't write script file \"%s\"", path);
+	return ok;
+}
+
+/**
+ * Main function.
+ */
+int main(int argc, char **restrict argv) {
+	SAU_ByteArr text = (SAU_ByteArr){0};
+	GenOpt go;
+	bool error = false;
+	if (!parse_args(argc, argv, &go))
+		return 0;
+	uint32_t first = go.kind, last = go.kind;
+	if (go.kind == GEN_ALL) {
+		first = 0;
+		last = GEN_KINDS - 1;
+	}
+	for (uint32_t kind = first; kind <= last; ++kind) {
+		if (!generate(&text, kind, &go)) {
+			SAU_error(NAME, "memory allocation failure");
+			error = true;
+			break;
+		}
+		if (go.out_path != NULL) {
+			error = !write_script(&text, go.out_path);
+			break;
+		}
+		if (!time_build(&text, gen_names[kind], go.repeats)) {
+			error = true;
+			break;
+		}
+	}
+	SAU_ByteArr_clear(&text);
+	return error ? 1 : 0;
+}
@@ -106,9 +106,9 @@ ABORT:
  * \return SAU_Program or NULL on error
  */
 static SAU_Program *build_program(const char *restrict script_arg,
-		bool is_path) {
+		bool is_path, bool print_info) {
 	SAU_Program *o = NULL;
-	SAU_MemPool *mempool = SAU_create_MemPool(0);
+	SAU_MemPool *mempool = SAU_obtain_MemPool(0);
 	SAU_SymTab *symtab = SAU_create_SymTab(mempool);
 	if (!symtab)
 		return NULL;
@@ -139,8 +139,16 @@ CLOSE:
 CLOSE:
 	SAU_destroy_Lexer(lexer);
 #endif
+	if (print_info) {
+		SAU_SymTabStats stats;
+		SAU_SymTab_get_stats(symtab, &stats);
+		fprintf(stderr,
+"symtab: %zu strings in %zu slots, %zu lookups, %zu probes, %zu upsizes\n",
+			stats.count, stats.alloc, stats.lookups,
+			stats.probes, stats.upsizes);
+	}
 	SAU_destroy_SymTab(symtab);
-	SAU_destroy_MemPool(mempool);
+	SAU_release_MemPool(mempool);
 	return o;
 }
 
@@ -151,12 +159,15 @@ CLOSE:
  * \return number of programs successfully built
  */
 size_t SAU_build(const SAU_PtrArr *restrict script_args, uint32_t options,
-		SAU_PtrArr *restrict prg_objs) {
+		SAU_PtrArr *restrict prg_objs,
+		const char *restrict cache_dir sauMaybeUnused) {
 	bool are_paths = !(options & SAU_ARG_EVAL_STRING);
+	bool print_info = (options & SAU_ARG_PRINT_INFO) != 0;
 	size_t built = 0;
 	const char **args = (const char**) SAU_PtrArr_ITEMS(script_args);
 	for (size_t i = 0; i < script_args->count; ++i) {
-		SAU_Program *prg = build_program(args[i], are_paths);
+		SAU_Program *prg = build_program(args[i], are_paths,
+				print_info);
 		if (prg != NULL) ++built;
 		SAU_PtrArr_add(prg_objs, prg);
 	}
@@ -184,7 +195,7 @@ int main(int argc, char **restrict argv) {
 	uint32_t options = 0;
 	if (!parse_args(argc, argv, &options, &script_args))
 		return 0;
-	bool error = !SAU_build(&script_args, options, &prg_objs);
+	bool error = !SAU_build(&script_args, options, &prg_objs, NULL);
 	SAU_PtrArr_clear(&script_args);
 	if (error)
 		return 1;
@@ -0,0 +1,155 @@
+/* saugns: Trace event recording module.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "trace.h"
+#include <stdio.h>
+
+static FILE *trace_f;
+static const char *trace_path;
+static uint64_t trace_t0;
+static bool trace_first;
+static sauThreadLocal bool trace_thread; // opened the file
+
+/**
+ * Start recording spans into a new file at \p path.
+ *
+ * \return true, or false if the file couldn't be created
+ */
+bool SAU_open_Trace(const char *restrict path) {
+	if (trace_thread)
+		SAU_close_Trace();
+	trace_f = fopen(path, "w");
+	if (!trace_f) {
+		SAU_error(NULL, "couldn't open trace file \"%s\"", path);
+		return false;
+	}
+	trace_path = path;
+	trace_t0 = SAU_time_ns();
+	trace_first = true;
+	trace_thread = true;
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", trace_f);
+	return true;
+}
+
+/**
+ * Finish recording spans, completing and closing the file.
+ *
+ * \return true unless writing failed
+ */
+bool SAU_close_Trace(void) {
+	if (!trace_thread)
+		return true;
+	fputs("\n]}\n", trace_f);
+	bool ok = !ferror(trace_f);
+	if (fclose(trace_f) != 0) ok = false;
+	if (!ok)
+		SAU_error(NULL, "couldn't write trace file \"%s\"", trace_path);
+	trace_f = NULL;
+	trace_path = NULL;
+	trace_thread = false;
+	return ok;
+}
+
+/**
+ * \return true if recording for the current thread
+ */
+bool SAU_Trace_enabled(void) {
+	return trace_thread;
+}
+
+/**
+ * Get start time for a span, to pass to an end function.
+ *
+ * \return nanoseconds, or 0 if not recording
+ */
+uint64_t SAU_Trace_begin(void) {
+	if (!trace_thread)
+		return 0;
+	return SAU_time_ns();
+}
+
+/*
+ * Write the start of a complete event for the span from \p start
+ * until \p end, up to where args may follow.
+ */
+static void put_span(uint64_t start, uint64_t end,
+		const char *restrict cat, const char *restrict name) {
+	start -= trace_t0;
+	end -= trace_t0;
+	fprintf(trace_f,
+		"%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+		"\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1",
+		trace_first ? "" : ",", name, cat,
+		start / 1000.0, (end - start) / 1000.0);
+	trace_first = false;
+}
+
+/*
+ * Write \p str as a JSON string.
+ */
+static void put_string(const char *restrict str) {
+	putc('"', trace_f);
+	for (; *str != '\0'; ++str) {
+		unsigned char c = *str;
+		if (c == '"' || c == '\\')
+			fprintf(trace_f, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(trace_f, "\\u%04x", c);
+		else
+			putc(c, trace_f);
+	}
+	putc('"', trace_f);
+}
+
+/**
+ * End span of category \p cat named \p name, begun at \p start,
+ * with an optional \p label (e.g. a script name) added if not NULL.
+ */
+void SAU_Trace_end(uint64_t start, const char *restrict cat,
+		const char *restrict name, const char *restrict label) {
+	if (!trace_thread)
+		return;
+	put_span(start, SAU_time_ns(), cat, name);
+	if (label != NULL) {
+		fputs(",\"args\":{\"label\":", trace_f);
+		put_string(label);
+		putc('}', trace_f);
+	}
+	putc('}', trace_f);
+}
+
+/**
+ * End span of category \p cat named \p name, begun at \p start,
+ * with the number \p n added under \p key.
+ */
+void SAU_Trace_end_n(uint64_t start, const char *restrict cat,
+		const char *restrict name,
+		const char *restrict key, uint64_t n) {
+	if (!trace_thread)
+		return;
+	SAU_Trace_put_n(start, SAU_time_ns(), cat, name, key, n);
+}
+
+/**
+ * Write span timed elsewhere, from \p start until \p end,
+ * otherwise as for SAU_Trace_end_n().
+ */
+void SAU_Trace_put_n(uint64_t start, uint64_t end,
+		const char *restrict cat, const char *restrict name,
+		const char *restrict key, uint64_t n) {
+	if (!trace_thread)
+		return;
+	put_span(start, end, cat, name);
+	fprintf(trace_f, ",\"args\":{\"%s\":%llu}}",
+			key, (unsigned long long) n);
+}
@@ -0,0 +1,39 @@
+/* saugns: Trace event recording module.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "common.h"
+
+/*
+ * Timed spans are written as trace event JSON, for viewing with
+ * e.g. Perfetto or chrome://tracing. Recording is done only for the
+ * thread which opened the file; elsewhere, or when not enabled, calls
+ * do nothing. Interpreters record their spans in memory instead, to
+ * be written between runs; see SAU_Interp_set_trace().
+ *
+ * Times are nanoseconds on the monotonic clock.
+ */
+
+bool SAU_open_Trace(const char *restrict path);
+bool SAU_close_Trace(void);
+bool SAU_Trace_enabled(void);
+
+uint64_t SAU_Trace_begin(void);
+void SAU_Trace_end(uint64_t start, const char *restrict cat,
+		const char *restrict name, const char *restrict label);
+void SAU_Trace_end_n(uint64_t start, const char *restrict cat,
+		const char *restrict name,
+		const char *restrict key, uint64_t n);
+void SAU_Trace_put_n(uint64_t start, uint64_t end,
+		const char *restrict cat, const char *restrict name,
+		const char *restrict key, uint64_t n);
@@ -103,17 +103,10 @@ static void hmirror_range(float *restrict lut,
 	}
 }
 
-/**
+/*
  * Fill in the look-up tables enumerated by SAU_WAVE_*.
- *
- * If already initialized, return without doing anything.
  */
-void SAU_global_init_Wave(void) {
-	static bool done = false;
-	if (done)
-		return;
-	done = true;
-
+static void fill_luts(void) {
 	float *const sin_lut = SAU_Wave_luts[SAU_WAVE_SIN];
 	float *const sqr_lut = SAU_Wave_luts[SAU_WAVE_SQR];
 	float *const tri_lut = SAU_Wave_luts[SAU_WAVE_TRI];
@@ -215,6 +208,36 @@ void SAU_global_init_Wave(void) {
 	}
 }
 
+/**
+ * Fill in the look-up tables enumerated by SAU_WAVE_*.
+ *
+ * If already initialized, return without doing anything.
+ * Thread-safe when built with GCC or Clang; a call made while
+ * another thread is initializing waits for it to finish.
+ */
+void SAU_global_init_Wave(void) {
+	static int state = 0; /* 0 = not done, 1 = in progress, 2 = done */
+#if defined(__GNUC__) || defined(__clang__)
+	int expected = 0;
+	if (__atomic_load_n(&state, __ATOMIC_ACQUIRE) == 2)
+		return;
+	if (!__atomic_compare_exchange_n(&state, &expected, 1, false,
+				__ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+		while (__atomic_load_n(&state, __ATOMIC_ACQUIRE) != 2)
+			;
+		return;
+	}
+	fill_luts();
+	__atomic_store_n(&state, 2, __ATOMIC_RELEASE);
+#else
+	if (state != 0)
+		return;
+	state = 1;
+	fill_luts();
+	state = 2;
+#endif
+}
+
 /**
  * Print an index-value table for a LUT.
  */